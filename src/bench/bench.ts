@@ -0,0 +1,198 @@
+import * as path from 'path';
+import * as fs from 'fs';
+import { ParseCounters, ParserOptions, parseText } from '../parser';
+const { performance, PerformanceObserver } = require('perf_hooks');
+
+// Benchmark of the parser over the test files, which runs in plain node:
+// npm run bench -- [--time <ms per case>] [--filter <file>] [--out <report>] [--compare <report>]
+
+/** Measurement of a file with an option set. */
+interface BenchCase {
+    file: string;
+    config: string;
+    lines: number;
+    calls: number;
+    linesPerSec: number;
+    p50: number;
+    p99: number;
+
+    /** Heap growth of a call after a collection, undefined if node runs without --expose-gc. */
+    heapPerCall: number | undefined;
+    gcCount: number;
+
+    /** Work of a call, which doesn't depend on the machine. */
+    counters: ParseCounters;
+    charVisitsPerChar: number;
+}
+
+interface BenchReport {
+    date: string;
+    commit: string | undefined;
+    node: string;
+    cases: BenchCase[];
+}
+
+/** Start times of the collections, the observer gets them after the measured calls. */
+const gcTimes = new Array<number>();
+const gcObserver = new PerformanceObserver((list: any) => {
+    for (const entry of list.getEntries())
+        gcTimes.push(entry.startTime);
+});
+gcObserver.observe({ entryTypes: ['gc'] });
+
+function getArg(name: string, defaultValue: string) {
+    const index = process.argv.indexOf('--' + name);
+    return index >= 0 && index + 1 < process.argv.length ? process.argv[index + 1] : defaultValue;
+}
+
+function getCommit() {
+    try {
+        return require('child_process').execSync('git rev-parse --short HEAD', { stdio: 'pipe' }).toString().trim();
+    }
+    catch (error) {
+        return undefined;
+    }
+}
+
+/** Returns the option sets: none, the defaults, all & all but one of the features. */
+function getConfigs() {
+    const toggles = Object.keys(new ParserOptions()).filter(key => /Enable$/.test(key));
+    const all: any = { preprocessorMinLines: 0, withinFunctionMinLines: 0, caseLabelMinLines: 0 };
+    const none: any = {};
+    for (const toggle of toggles) {
+        all[toggle] = true;
+        none[toggle] = false;
+    }
+    const configs = new Map<string, Partial<ParserOptions>>();
+    configs.set('none', none);
+    configs.set('default', {});
+    configs.set('all', all);
+    for (const toggle of toggles) {
+        const options = Object.assign({}, all);
+        options[toggle] = false;
+        configs.set('all -' + toggle.replace(/Enable$/, ''), options);
+    }
+    return configs;
+}
+
+/** Returns the value at a fraction of the sorted values. */
+function percentile(sorted: number[], fraction: number) {
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * fraction))];
+}
+
+/** Returns the number of collections in a time span, after the observer got them. */
+async function countGc(start: number, end: number) {
+    await new Promise(resolve => setTimeout(resolve, 10));
+    return gcTimes.filter(time => time >= start && time <= end).length;
+}
+
+async function measure(file: string, text: string, config: string, options: Partial<ParserOptions>, time: number) {
+    const counters = new ParseCounters();
+    const lines = parseText(text, options, counters).result.lineCount;
+    const gc: (() => void) | undefined = (<any>global).gc;
+
+    // Warm up
+    for (let i = 0; i < 5; i++)
+        parseText(text, options);
+
+    let heapPerCall: number | undefined = undefined;
+    if (gc !== undefined) {
+        const growth = new Array<number>();
+        for (let i = 0; i < 10; i++) {
+            gc();
+            const used = process.memoryUsage().heapUsed;
+            parseText(text, options);
+            growth.push(process.memoryUsage().heapUsed - used);
+        }
+        heapPerCall = percentile(growth.sort((a, b) => a - b), 0.5);
+    }
+
+    const durations = new Array<number>();
+    const start = performance.now();
+    while (durations.length < 20 || performance.now() - start < time) {
+        const t0 = performance.now();
+        parseText(text, options);
+        durations.push(performance.now() - t0);
+    }
+    const gcCount = await countGc(start, performance.now());
+
+    const total = durations.reduce((sum, duration) => sum + duration, 0);
+    durations.sort((a, b) => a - b);
+    const result: BenchCase = {
+        file: file, config: config, lines: lines, calls: durations.length,
+        linesPerSec: Math.round(lines * durations.length * 1000 / total),
+        p50: percentile(durations, 0.5), p99: percentile(durations, 0.99),
+        heapPerCall: heapPerCall, gcCount: gcCount,
+        counters: counters, charVisitsPerChar: counters.charVisitsPerChar(),
+    };
+    return result;
+}
+
+function pad(value: string, width: number) {
+    while (value.length < width)
+        value = ' ' + value;
+    return value;
+}
+
+function printCase(result: BenchCase, previous: BenchCase | undefined) {
+    let line = (result.file + ' ' + result.config + '                                        ').substring(0, 44)
+        + pad(result.linesPerSec + '', 10) + ' lines/s'
+        + pad(result.p50.toFixed(3), 9) + ' ms p50'
+        + pad(result.p99.toFixed(3), 9) + ' ms p99'
+        + pad(result.heapPerCall === undefined ? '-' : (result.heapPerCall / 1024).toFixed(0), 8) + ' KiB'
+        + pad(result.gcCount + '', 5) + ' gc'
+        + pad(result.charVisitsPerChar.toFixed(2), 6) + ' visits/char';
+    if (previous !== undefined)
+        line += pad((result.linesPerSec / previous.linesPerSec * 100 - 100).toFixed(1) + '%', 9);
+    console.log(line);
+}
+
+async function main() {
+    const testFiles = path.join(__dirname, '../../src/test/test-files');
+    const time = Number(getArg('time', '200'));
+    const filter = getArg('filter', '');
+    const outFile = getArg('out', path.join(__dirname, 'report.json'));
+    const compareFile = getArg('compare', '');
+
+    const previous = new Map<string, BenchCase>();
+    if (compareFile.length > 0) {
+        const report: BenchReport = JSON.parse(fs.readFileSync(compareFile, 'utf8'));
+        for (const result of report.cases)
+            previous.set(result.file + ' ' + result.config, result);
+    }
+
+    const report: BenchReport = {
+        date: new Date().toISOString(), commit: getCommit(), node: process.version, cases: [],
+    };
+    if ((<any>global).gc === undefined)
+        console.log('Run node with --expose-gc to measure the heap per call');
+
+    const configs = getConfigs();
+    const files = fs.readdirSync(testFiles).filter(file => file.indexOf(filter) >= 0).sort();
+    for (const file of files) {
+        const text = fs.readFileSync(path.join(testFiles, file), 'utf8');
+        for (const [config, options] of configs) {
+            const result = await measure(file, text, config, options, time);
+            printCase(result, previous.get(file + ' ' + config));
+            report.cases.push(result);
+        }
+    }
+
+    // The fixed cost of a call dominates for small documents
+    const small = 'switch.cpp:30';
+    if (small.indexOf(filter) >= 0) {
+        const text = fs.readFileSync(path.join(testFiles, 'switch.cpp'), 'utf8').split(/\r?\n/).slice(0, 30).join('\n');
+        const result = await measure(small, text, 'all', configs.get('all') || {}, time);
+        printCase(result, previous.get(small + ' all'));
+        report.cases.push(result);
+    }
+
+    fs.writeFileSync(outFile, JSON.stringify(report, null, 2));
+    console.log('Report: ' + outFile);
+    gcObserver.disconnect();
+}
+
+main().catch(error => {
+    console.error(error);
+    process.exit(1);
+});
\ No newline at end of file
@@ -0,0 +1,203 @@
+/** Kinds of generated C++ code. */
+export type CorpusShape = 'mixed' | 'nested' | 'functions' | 'switch' | 'docs' | 'preprocessor' | 'strings' | 'raw';
+
+export const corpusShapes: CorpusShape[] = ['mixed', 'nested', 'functions', 'switch', 'docs', 'preprocessor', 'strings', 'raw'];
+
+/** Deterministic pseudo random numbers (mulberry32), so a seed always gives the same text. */
+class Random {
+    private state_: number;
+
+    constructor(p_seed: number) {
+        this.state_ = p_seed >>> 0;
+    }
+
+    public next() {
+        let t = this.state_ = (this.state_ + 0x6D2B79F5) >>> 0;
+        t = Math.imul(t ^ (t >>> 15), t | 1);
+        t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+        return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+    }
+
+    /** Returns an integer from min to max, both included. */
+    public int(min: number, max: number) {
+        return min + Math.floor(this.next() * (max - min + 1));
+    }
+}
+
+/** Appends the lines of code blocks of a shape. */
+class CorpusWriter {
+    lines = new Array<string>();
+    private random_: Random;
+    private id_ = 0;
+
+    constructor(p_seed: number) {
+        this.random_ = new Random(p_seed);
+    }
+
+    private indent(depth: number) {
+        let text = '';
+        for (let i = 0; i < depth; i++)
+            text += '    ';
+        return text;
+    }
+
+    private name(prefix: string) {
+        return prefix + (this.id_++);
+    }
+
+    public write(shape: CorpusShape) {
+        switch (shape) {
+            case 'mixed': {
+                const shapes = corpusShapes.slice(1);
+                this.write(shapes[this.random_.int(0, shapes.length - 1)]);
+                break;
+            }
+            case 'nested': this.writeNested(this.random_.int(1, 6), 0); break;
+            case 'functions': {
+                for (let i = this.random_.int(5, 50); i > 0; i--)
+                    this.writeFunction(0);
+                break;
+            }
+            case 'switch': this.writeSwitch(this.random_.int(50, 500)); break;
+            case 'docs': this.writeDoc(this.random_.int(5, 60)); break;
+            case 'preprocessor': this.writeLadder(this.random_.int(1, 4)); break;
+            case 'strings': this.writeStrings(this.random_.int(5, 50)); break;
+            case 'raw': this.writeRawString(this.random_.int(2, 40)); break;
+        }
+    }
+
+    /** Namespaces, classes, structs & enums nested up to a depth. */
+    private writeNested(depth: number, level: number) {
+        const lines = this.lines;
+        const indent = this.indent(level);
+        const kind = level === 0 || this.random_.next() < 0.3 ? 'namespace' : this.random_.next() < 0.5 ? 'class' : 'struct';
+        const close = kind === 'namespace' ? '}' : '};';
+        lines.push(indent + kind + ' ' + this.name(kind === 'namespace' ? 'n' : 'C'));
+        lines.push(indent + '{');
+        if (kind === 'class')
+            lines.push(indent + 'public:');
+        lines.push(indent + '    enum ' + this.name('E') + ' { A, B, C };');
+        lines.push(indent + '    enum class ' + this.name('E'));
+        lines.push(indent + '    {');
+        for (let i = this.random_.int(1, 8); i > 0; i--)
+            lines.push(indent + '        V' + i + ',');
+        lines.push(indent + '    };');
+        if (depth > 1)
+            this.writeNested(depth - 1, level + 1);
+        for (let i = this.random_.int(0, 3); i > 0; i--)
+            this.writeFunction(level + 1);
+        lines.push(indent + close);
+    }
+
+    private writeFunction(level: number) {
+        const lines = this.lines;
+        const indent = this.indent(level);
+        lines.push(indent + 'int ' + this.name('f') + '(int a,');
+        lines.push(indent + '    int b)');
+        lines.push(indent + '{');
+        lines.push(indent + '    // Return the larger value {');
+        lines.push(indent + '    if (a > b) {');
+        lines.push(indent + '        return a;');
+        lines.push(indent + '    }');
+        for (let i = this.random_.int(0, 4); i > 0; i--)
+            lines.push(indent + '    b = b * ' + i + ' + (a - ' + i + ');');
+        lines.push(indent + '    for (int i = 0; i < b; i++)');
+        lines.push(indent + '    {');
+        lines.push(indent + '        a += i;');
+        lines.push(indent + '    }');
+        lines.push(indent + '    return b;');
+        lines.push(indent + '}');
+        lines.push('');
+    }
+
+    private writeSwitch(cases: number) {
+        const lines = this.lines;
+        lines.push('void ' + this.name('dispatch') + '(int value)');
+        lines.push('{');
+        lines.push('    switch (value)');
+        lines.push('    {');
+        for (let i = 0; i < cases; i++) {
+            lines.push('        case ' + i + ':');
+            if (this.random_.next() < 0.3) {
+                lines.push('        {');
+                lines.push('            int x = value * ' + i + ';');
+                lines.push('            handle(x);');
+                lines.push('            break;');
+                lines.push('        }');
+            }
+            else {
+                lines.push('            handle(' + i + ');');
+                lines.push('            break;');
+            }
+        }
+        lines.push('        default:');
+        lines.push('            break;');
+        lines.push('    }');
+        lines.push('}');
+        lines.push('');
+    }
+
+    private writeDoc(length: number) {
+        const lines = this.lines;
+        lines.push('/**');
+        lines.push(' * @brief Generated documentation { with braces } & // slashes');
+        for (let i = 0; i < length; i++)
+            lines.push(' * Line ' + i + ' of the description, see @ref ' + this.name('f') + '().');
+        lines.push(' */');
+        lines.push('int ' + this.name('g') + '(int a);');
+        lines.push('');
+    }
+
+    /** `#if`/`#elif`/`#else` chains, which contain code & nested chains. */
+    private writeLadder(depth: number) {
+        const lines = this.lines;
+        lines.push('#if defined(' + this.name('FEATURE_') + ')');
+        for (let i = this.random_.int(1, 5); i > 0; i--) {
+            lines.push('int ' + this.name('value') + ' = ' + i + ';');
+            if (depth > 1 && this.random_.next() < 0.5)
+                this.writeLadder(depth - 1);
+            lines.push('#elif ' + this.name('VERSION_') + ' > ' + i);
+        }
+        lines.push('struct ' + this.name('S') + ' { int a; };');
+        lines.push('#else');
+        lines.push('#  define ' + this.name('MACRO_') + '(x) { (x) }');
+        lines.push('#endif');
+    }
+
+    /** Literals with braces & comment starts, which must not be taken as code. */
+    private writeStrings(count: number) {
+        const lines = this.lines;
+        lines.push('const char* ' + this.name('table') + '[] =');
+        lines.push('{');
+        for (let i = 0; i < count; i++) {
+            switch (i % 4) {
+                case 0: lines.push('    "{ // not a comment " "\\" {",'); break;
+                case 1: lines.push('    "/* not a block */ }",'); break;
+                case 2: lines.push('    u8"escaped \\\\" "} {",'); break;
+                case 3: lines.push('    L"tab\\t{" /* { */,'); break;
+            }
+        }
+        lines.push('};');
+        lines.push("const char open = '{', close = '}', quote = '\\'';");
+        lines.push('');
+    }
+
+    private writeRawString(length: number) {
+        const lines = this.lines;
+        lines.push('const char* ' + this.name('json') + ' = R"json(');
+        lines.push('{');
+        for (let i = 0; i < length; i++)
+            lines.push('    "key' + i + '": { "value": "// ' + i + ' /* {" },');
+        lines.push('}');
+        lines.push(')json";');
+        lines.push('');
+    }
+}
+
+/** Returns C++ code of about a number of lines, the same seed gives the same text. */
+export function generateCpp(lineCount: number, shape: CorpusShape = 'mixed', seed: number = 1): string {
+    const writer = new CorpusWriter(seed);
+    while (writer.lines.length < lineCount)
+        writer.write(shape);
+    return writer.lines.join('\n') + '\n';
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+import * as fs from 'fs';
+import * as path from 'path';
+const Module = require('module');
+import { ParserOptions, parseText } from '../parser';
+import { corpusShapes, generateCpp } from './corpus';
+
+// Runs a baseline build & this one over the test files & generated code and reports the
+// ranges, which only one of them finds:
+// npm run bench:diff -- --baseline <out directory of the baseline> [--lines <n>] [--seeds <n>]
+// The baseline can be built from another commit, e.g. in a git worktree with npm run compile.
+// Builds before parseText() existed are run through their FoldingProvider with a stub of vscode.
+
+type ParseText = (text: string, options?: Partial<ParserOptions>) => { foldingLines: Int32Array };
+
+/** Options of the test dump & the defaults of the settings. */
+const configs: { [name: string]: Partial<ParserOptions> } = {
+    'all': {
+        classEnable: true, enumEnable: true, namespaceEnable: true, preprocessorEnable: true, structEnable: true,
+        withinFunctionEnable: true, caseLabelEnable: true,
+    },
+    'default': {},
+};
+
+/** Returns the setting of an option, e.g. 'caseLabel.minLines' for caseLabelMinLines. */
+function toSetting(option: string) {
+    return option.replace(/(Enable|IgnoreGuard|MinLines|RecursiveDepth)$/, suffix => '.' + suffix[0].toLowerCase() + suffix.substring(1));
+}
+
+/**
+ * Returns parseText() of a build, which only has the FoldingProvider. vscode is replaced by a stub,
+ * which returns the options as settings & provides the lines of the text as document.
+ */
+function loadProviderBaseline(dir: string): ParseText {
+    let settings: { [name: string]: any } = {};
+    class FoldingRange {
+        start: number;
+        end: number;
+
+        constructor(p_start: number, p_end: number) {
+            this.start = p_start;
+            this.end = p_end;
+        }
+    }
+    const vscode = {
+        FoldingRange: FoldingRange,
+        window: { activeTextEditor: undefined, createOutputChannel: () => ({ appendLine: () => { }, show: () => { } }) },
+        workspace: { getConfiguration: () => ({ get: (name: string, value: any) => name in settings ? settings[name] : value }) },
+    };
+    const stubId = path.join(dir, '__vscode_stub__');
+    const resolve = Module._resolveFilename;
+    Module._resolveFilename = function (this: any, request: string) {
+        return request === 'vscode' ? stubId : resolve.apply(this, arguments);
+    };
+    require.cache[stubId] = <any>{ id: stubId, filename: stubId, loaded: true, exports: vscode };
+
+    require(path.resolve(dir, 'globalConfig')).updateConfig();
+    const Provider = require(path.resolve(dir, 'foldingProvider')).default;
+    const provider = new Provider(true);
+    return (text: string, options?: Partial<ParserOptions>) => {
+        const all: any = Object.assign(new ParserOptions(), options);
+        settings = {};
+        for (const option in all)
+            settings[toSetting(option)] = all[option];
+        const lines = text.split(/\r\n|\r|\n/);
+        const ranges: FoldingRange[] = provider.provideFoldingRanges({
+            lineCount: lines.length, lineAt: (line: number) => ({ text: lines[line] }),
+        });
+        const foldingLines = new Int32Array(2 * ranges.length);
+        ranges.forEach((range, i) => {
+            foldingLines[2 * i] = range.start;
+            foldingLines[2 * i + 1] = range.end;
+        });
+        return { foldingLines: foldingLines };
+    };
+}
+
+/** Returns parseText() of the baseline build. */
+function loadBaseline(dir: string): ParseText {
+    let parser: any;
+    try {
+        parser = require(path.resolve(dir, 'parser'));
+    }
+    catch (error) {
+        if (error.code !== 'MODULE_NOT_FOUND')
+            throw error;
+        return loadProviderBaseline(dir);
+    }
+    if (typeof parser.parseText !== 'function')
+        throw new Error('The baseline doesn\'t export parseText()');
+    return parser.parseText;
+}
+
+function getArg(name: string, defaultValue: string) {
+    const index = process.argv.indexOf('--' + name);
+    return index >= 0 && index + 1 < process.argv.length ? process.argv[index + 1] : defaultValue;
+}
+
+/** Returns the number of each range, given as start & end lines. */
+function countRanges(lines: Int32Array) {
+    const counts = new Map<string, number>();
+    for (let i = 0; i < lines.length; i += 2) {
+        const key = lines[i] + '-' + lines[i + 1];
+        counts.set(key, (counts.get(key) || 0) + 1);
+    }
+    return counts;
+}
+
+/** Returns the ranges, which are found more often in a than in b. */
+function subtract(a: Map<string, number>, b: Map<string, number>) {
+    const ranges = new Array<string>();
+    a.forEach((count, key) => {
+        for (let i = b.get(key) || 0; i < count; i++)
+            ranges.push(key);
+    });
+    return ranges.sort((r1, r2) => parseInt(r1) - parseInt(r2));
+}
+
+/** Prints the ranges with the text of the start line, returns the number of ranges. */
+function printRanges(label: string, ranges: string[], lines: string[]) {
+    for (let i = 0; i < Math.min(10, ranges.length); i++) {
+        const start = parseInt(ranges[i]);
+        console.log('    ' + label + ' [L' + ranges[i] + '] ' + (lines[start] || '').trim().substring(0, 60));
+    }
+    if (ranges.length > 10)
+        console.log('    ' + label + ' ' + (ranges.length - 10) + ' more');
+    return ranges.length;
+}
+
+function main() {
+    const baselineDir = getArg('baseline', '');
+    if (baselineDir.length === 0) {
+        console.log('Usage: npm run bench:diff -- --baseline <out directory> [--lines <n>] [--seeds <n>]');
+        process.exit(2);
+    }
+    const baseline = loadBaseline(baselineDir);
+    const lineCount = Number(getArg('lines', '3000'));
+    const seeds = Number(getArg('seeds', '3'));
+
+    // Test files & generated code of each shape
+    const inputs = new Map<string, string>();
+    const testFiles = path.join(__dirname, '../../src/test/test-files');
+    for (const file of fs.readdirSync(testFiles).sort())
+        inputs.set(file, fs.readFileSync(path.join(testFiles, file), 'utf8'));
+    for (const shape of corpusShapes) {
+        for (let seed = 1; seed <= seeds; seed++)
+            inputs.set(shape + '-' + seed + '.cpp', generateCpp(lineCount, shape, seed));
+    }
+
+    let divergent = 0;
+    let failed = 0;
+    inputs.forEach((text, name) => {
+        for (const config in configs) {
+            // Old builds fail on inputs beyond their limits, e.g. 500 ranges of a kind
+            let baselineLines: Int32Array;
+            try {
+                baselineLines = baseline(text, configs[config]).foldingLines;
+            }
+            catch (error) {
+                console.log(name + ' (' + config + '): the baseline failed: ' + error);
+                failed++;
+                continue;
+            }
+            const expected = countRanges(baselineLines);
+            const actual = countRanges(parseText(text, configs[config]).foldingLines);
+            const missing = subtract(expected, actual);
+            const added = subtract(actual, expected);
+            if (missing.length === 0 && added.length === 0)
+                continue;
+            console.log(name + ' (' + config + '): ' + missing.length + ' missing, ' + added.length + ' added');
+            const lines = text.split(/\r\n|\r|\n/);
+            divergent += printRanges('-', missing, lines) + printRanges('+', added, lines);
+        }
+    });
+    console.log(inputs.size + ' inputs, ' + divergent + ' divergent ranges'
+        + (failed > 0 ? ', the baseline failed ' + failed + ' times' : ''));
+    process.exit(divergent > 0 ? 1 : 0);
+}
+
+main();
\ No newline at end of file
@@ -0,0 +1,92 @@
+import * as fs from 'fs';
+import * as path from 'path';
+import Parser, { ParseCounters, ParseState, TextSnapshot, parseText } from '../parser';
+import { EditTrace, applyChanges } from '../editTrace';
+const { performance } = require('perf_hooks');
+
+// Replays recorded edits against the parser & reports the latency per edit, which is what
+// is felt while typing: npm run bench:replay -- [<trace>...] [--runs <n>] [--check]
+// Without traces, the traces in src/bench/traces are replayed.
+
+const allOptions = {
+    classEnable: true, enumEnable: true, namespaceEnable: true, structEnable: true, preprocessorEnable: true,
+    withinFunctionEnable: true, caseLabelEnable: true,
+};
+
+/** Returns the value at a fraction of the sorted values. */
+function percentile(sorted: number[], fraction: number) {
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * fraction))];
+}
+
+/** Returns the texts after each edit, so creating them isn't measured. */
+function getSnapshots(trace: EditTrace, text: string) {
+    const snapshots = new Array<TextSnapshot>();
+    for (let i = 0; i < trace.edits.length; i++) {
+        text = applyChanges(text, trace.edits[i].changes);
+        snapshots.push(new TextSnapshot(text, i + 2));
+    }
+    return snapshots;
+}
+
+/** Replays the edits & returns the milliseconds per edit, the work of the edits is added to the counters. */
+function replay(trace: EditTrace, initial: TextSnapshot, snapshots: TextSnapshot[], check: boolean,
+    counters?: ParseCounters) {
+    const parser = new Parser(allOptions);
+    const state = new ParseState();
+    parser.parseDocument(initial, state);
+    state.counters = counters;
+
+    const durations = new Array<number>(snapshots.length);
+    for (let i = 0; i < snapshots.length; i++) {
+        const snapshot = snapshots[i];
+        const t0 = performance.now();
+        parser.recordChanges(state, snapshot, trace.edits[i].changes);
+        parser.parseDocument(snapshot, state);
+        const lines = parser.getFoldingLines(state.result);
+        durations[i] = performance.now() - t0;
+
+        if (check && lines.join() !== parseText(snapshot.text, allOptions).foldingLines.join())
+            throw new Error('Edit ' + i + ' gives other ranges than a full parse');
+    }
+    return durations;
+}
+
+function main() {
+    const testFiles = path.join(__dirname, '../../src/test/test-files');
+    const traceDir = path.join(__dirname, '../../src/bench/traces');
+    const args = process.argv.slice(2);
+    const runsIndex = args.indexOf('--runs');
+    const runs = runsIndex >= 0 ? Number(args[runsIndex + 1]) : 5;
+    const check = args.indexOf('--check') >= 0;
+    let files = args.filter((arg, i) => arg.indexOf('--') !== 0 && (runsIndex < 0 || i !== runsIndex + 1));
+    if (files.length === 0)
+        files = fs.readdirSync(traceDir).filter(file => /\.json$/.test(file)).sort().map(file => path.join(traceDir, file));
+
+    for (const file of files) {
+        const trace: EditTrace = JSON.parse(fs.readFileSync(file, 'utf8'));
+        const text = trace.text !== undefined ? trace.text : fs.readFileSync(path.join(testFiles, trace.file || ''), 'utf8');
+        const initial = new TextSnapshot(text, 1);
+        const snapshots = getSnapshots(trace, text);
+
+        // The first run warms up
+        const counters = new ParseCounters();
+        replay(trace, initial, snapshots, check, counters);
+        const t0 = performance.now();
+        parseText(text, allOptions);
+        const fullParse = performance.now() - t0;
+        let durations = new Array<number>();
+        for (let i = 0; i < runs; i++)
+            durations = durations.concat(replay(trace, initial, snapshots, false));
+
+        durations.sort((a, b) => a - b);
+        console.log(path.basename(file) + ': ' + trace.edits.length + ' edits, ' + initial.lineCount + ' lines, '
+            + 'full parse ' + fullParse.toFixed(2) + ' ms, per edit'
+            + ' p50 ' + percentile(durations, 0.5).toFixed(3)
+            + ' p95 ' + percentile(durations, 0.95).toFixed(3)
+            + ' p99 ' + percentile(durations, 0.99).toFixed(3)
+            + ' max ' + durations[durations.length - 1].toFixed(3) + ' ms, '
+            + (counters.linesLexed / trace.edits.length).toFixed(1) + ' lines lexed per edit');
+    }
+}
+
+main();
\ No newline at end of file
@@ -0,0 +1,128 @@
+import * as fs from 'fs';
+import * as path from 'path';
+import { parseText } from '../parser';
+import { CorpusShape, corpusShapes, generateCpp } from './corpus';
+const { performance } = require('perf_hooks');
+
+// Parses generated C++ code of growing size, which shows super-linear behavior:
+// npm run bench:scale -- [--shape <shape>|all] [--min <lines>] [--max <lines>] [--csv <file>] [--write <dir>]
+
+interface ScaleCase {
+    shape: string;
+    lines: number;
+    ms: number;
+    usPerLine: number;
+
+    /** Heap kept by the result, undefined if node runs without --expose-gc. */
+    bytesPerLine: number | undefined;
+}
+
+const allOptions = {
+    classEnable: true, enumEnable: true, namespaceEnable: true, structEnable: true, preprocessorEnable: true,
+    withinFunctionEnable: true, caseLabelEnable: true,
+};
+
+function getArg(name: string, defaultValue: string) {
+    const index = process.argv.indexOf('--' + name);
+    return index >= 0 && index + 1 < process.argv.length ? process.argv[index + 1] : defaultValue;
+}
+
+/** Returns the used heap, including the typed arrays of the results. */
+function heapUsed() {
+    const usage = process.memoryUsage();
+    return usage.heapUsed + usage.external;
+}
+
+/** Collects the garbage, the typed arrays are only freed after a tick. */
+async function collect(gc: () => void) {
+    gc();
+    await new Promise(resolve => setTimeout(resolve, 0));
+    gc();
+}
+
+/** Returns the median time of a few parses & the heap kept by the result. */
+async function measure(shape: CorpusShape, text: string, lines: number) {
+    const gc: (() => void) | undefined = (<any>global).gc;
+    const durations = new Array<number>();
+    let bytesPerLine: number | undefined = undefined;
+    const start = performance.now();
+    while (durations.length < 3 || (durations.length < 15 && performance.now() - start < 1000)) {
+        if (gc !== undefined)
+            await collect(gc);
+        const used = heapUsed();
+        const t0 = performance.now();
+        // Keeps the result alive until the heap is measured
+        const kept = [parseText(text, allOptions)];
+        durations.push(performance.now() - t0);
+        if (gc !== undefined && durations.length === 2) {
+            await collect(gc);
+            bytesPerLine = (heapUsed() - used) / lines;
+        }
+        kept.length = 0;
+    }
+    durations.sort((a, b) => a - b);
+    const ms = durations[durations.length >> 1];
+    const result: ScaleCase = {
+        shape: shape, lines: lines, ms: ms, usPerLine: ms * 1000 / lines, bytesPerLine: bytesPerLine,
+    };
+    return result;
+}
+
+function pad(value: string, width: number) {
+    while (value.length < width)
+        value = ' ' + value;
+    return value;
+}
+
+/** Prints a case with a bar of the time per line, relative to the smallest size. */
+function printCase(result: ScaleCase, base: ScaleCase) {
+    let bar = '';
+    for (let i = Math.min(60, Math.round(result.usPerLine / base.usPerLine * 10)); i > 0; i--)
+        bar += '#';
+    console.log((result.shape + '             ').substring(0, 13)
+        + pad(result.lines + '', 9) + ' lines'
+        + pad(result.ms.toFixed(1), 10) + ' ms'
+        + pad(result.usPerLine.toFixed(3), 8) + ' us/line'
+        + pad(result.bytesPerLine === undefined ? '-' : result.bytesPerLine.toFixed(0), 6) + ' B/line  ' + bar);
+}
+
+async function main() {
+    const shapeArg = getArg('shape', 'mixed');
+    const shapes = shapeArg === 'all' ? corpusShapes : [<CorpusShape>shapeArg];
+    const min = Number(getArg('min', '1000'));
+    const max = Number(getArg('max', '1000000'));
+    const csvFile = getArg('csv', '');
+    const writeDir = getArg('write', '');
+    if (shapes.some(shape => corpusShapes.indexOf(shape) < 0))
+        throw new Error('Unknown shape, use all or one of: ' + corpusShapes.join(', '));
+    if ((<any>global).gc === undefined)
+        console.log('Run node with --expose-gc to measure the heap per line');
+
+    const csv = ['shape,lines,ms,us_per_line,bytes_per_line'];
+    for (const shape of shapes) {
+        let base: ScaleCase | undefined = undefined;
+        // Doubles the lines, the last step is clamped, so max itself is measured
+        for (let lines = Math.min(min, max); ; lines = Math.min(2 * lines, max)) {
+            const text = generateCpp(lines, shape);
+            if (writeDir.length > 0)
+                fs.writeFileSync(path.join(writeDir, shape + '-' + lines + '.cpp'), text);
+            const result = await measure(shape, text, text.split('\n').length);
+            if (base === undefined)
+                base = result;
+            printCase(result, base);
+            csv.push([result.shape, result.lines, result.ms.toFixed(3), result.usPerLine.toFixed(4),
+                result.bytesPerLine === undefined ? '' : result.bytesPerLine.toFixed(1)].join(','));
+            if (lines >= max)
+                break;
+        }
+    }
+    if (csvFile.length > 0) {
+        fs.writeFileSync(csvFile, csv.join('\n') + '\n');
+        console.log('CSV: ' + csvFile);
+    }
+}
+
+main().catch(error => {
+    console.error(error);
+    process.exit(1);
+});
\ No newline at end of file
@@ -0,0 +1,114 @@
+const { performance } = require('perf_hooks');
+
+/** Event of the Chrome trace event format, which chrome://tracing & Perfetto open. */
+export interface TraceEvent {
+    name: string;
+    cat: string;
+    /** Phase: X complete span, i instant, b & e begin & end of an async span, M metadata. */
+    ph: string;
+    /** Microseconds since the capture started. */
+    ts: number;
+    dur?: number;
+    pid: number;
+    tid: number;
+    id?: number;
+    s?: string;
+    args?: { [name: string]: any };
+}
+
+/** Threads of the trace, the phases are a separate row, since they don't nest in time. */
+export enum TraceThread {
+    Requests = 1,
+    Phases = 2,
+}
+
+/** Document of the spans, it is attached to each span. */
+export interface TraceDocument {
+    uri: { toString(): string };
+    version: number;
+    lineCount: number;
+}
+
+/** Spans of the parses & requests since the capture started, up to a maximal number of events. */
+export default class ChromeTrace {
+
+    private events_ = new Array<TraceEvent>();
+    private maxEvents_: number;
+    private dropped_ = 0;
+    private nextId_ = 1;
+    private pid_ = process.pid;
+
+    /** performance.now() at the start of the capture. */
+    readonly startTime: number;
+
+    constructor(p_maxEvents = 1000000) {
+        this.maxEvents_ = p_maxEvents;
+        this.startTime = performance.now();
+        this.addThreadName(TraceThread.Requests, 'cfold requests');
+        this.addThreadName(TraceThread.Phases, 'cfold parse phases (accumulated)');
+    }
+
+    get length() {
+        return this.events_.length;
+    }
+
+    /** Returns the arguments of a span of a document. */
+    public static documentArgs(document: TraceDocument, args?: { [name: string]: any }) {
+        const result: { [name: string]: any } = { uri: document.uri.toString(), version: document.version, lineCount: document.lineCount };
+        if (args !== undefined) {
+            for (const name in args)
+                result[name] = args[name];
+        }
+        return result;
+    }
+
+    /** Adds a span from start to end, both in milliseconds of performance.now(). */
+    public span(name: string, cat: string, start: number, end: number, args?: { [name: string]: any },
+        tid = TraceThread.Requests) {
+        this.add({ name: name, cat: cat, ph: 'X', ts: this.toTs(start), dur: Math.max(0, (end - start) * 1000),
+            pid: this.pid_, tid: tid, args: args });
+    }
+
+    public instant(name: string, cat: string, time: number, args?: { [name: string]: any }) {
+        this.add({ name: name, cat: cat, ph: 'i', s: 't', ts: this.toTs(time), pid: this.pid_,
+            tid: TraceThread.Requests, args: args });
+    }
+
+    /** Begins a span, which may overlap other spans, e.g. a request waiting for the worker. Returns its id. */
+    public beginAsync(name: string, cat: string, time: number, args?: { [name: string]: any }) {
+        const id = this.nextId_++;
+        this.add({ name: name, cat: cat, ph: 'b', id: id, ts: this.toTs(time), pid: this.pid_,
+            tid: TraceThread.Requests, args: args });
+        return id;
+    }
+
+    public endAsync(id: number, name: string, cat: string, time: number, args?: { [name: string]: any }) {
+        this.add({ name: name, cat: cat, ph: 'e', id: id, ts: this.toTs(time), pid: this.pid_,
+            tid: TraceThread.Requests, args: args });
+    }
+
+    /** Returns the JSON object format of the trace. */
+    public toJSON() {
+        return {
+            traceEvents: this.events_,
+            displayTimeUnit: 'ms',
+            otherData: { droppedEvents: this.dropped_ },
+        };
+    }
+
+    private toTs(time: number) {
+        return Math.round((time - this.startTime) * 1000);
+    }
+
+    private add(event: TraceEvent) {
+        if (this.events_.length < this.maxEvents_)
+            this.events_.push(event);
+        else
+            this.dropped_++;
+    }
+
+    private addThreadName(tid: TraceThread, name: string) {
+        this.events_.push({ name: 'thread_name', cat: '__metadata', ph: 'M', ts: 0, pid: this.pid_, tid: tid,
+            args: { name: name } });
+    }
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+import * as vscode from 'vscode'
+import * as fs from 'fs';
+import ChromeTrace from './chromeTrace';
+import FoldingProvider from './foldingProvider';
+import { logError } from './logger';
+
+/**
+ * Captures the spans of the folding provider until it is stopped & saves them as a Chrome
+ * trace, which opens in chrome://tracing or Perfetto.
+ */
+export default class ChromeTraceRecorder implements vscode.Disposable {
+
+    private provider_: FoldingProvider;
+    private trace_: ChromeTrace | undefined = undefined;
+
+    constructor(p_provider: FoldingProvider) {
+        this.provider_ = p_provider;
+    }
+
+    /** Starts capturing or stops & saves the captured trace. */
+    public toggle() {
+        if (this.trace_ === undefined)
+            this.start();
+        else
+            this.stop();
+    }
+
+    public dispose() {
+        if (this.trace_ !== undefined)
+            this.provider_.setTrace(undefined);
+        this.trace_ = undefined;
+    }
+
+    private start() {
+        this.trace_ = new ChromeTrace();
+        this.provider_.setTrace(this.trace_);
+        vscode.window.showInformationMessage('cfold: Capturing a trace of the folding requests, run the command again to stop.');
+    }
+
+    private async stop() {
+        const trace = this.trace_;
+        this.dispose();
+        if (trace === undefined)
+            return;
+
+        const editor = vscode.window.activeTextEditor;
+        const uri = await vscode.window.showSaveDialog({
+            defaultUri: editor === undefined || editor.document.isUntitled ? undefined
+                : vscode.Uri.file(editor.document.fileName + '.cfold-trace.json'),
+            filters: { 'Chrome trace': ['json'] },
+        });
+        if (uri === undefined)
+            return;
+        try {
+            fs.writeFileSync(uri.fsPath, JSON.stringify(trace));
+            vscode.window.showInformationMessage('cfold: Saved ' + trace.length + ' trace events to ' + uri.fsPath
+                + ', open it in chrome://tracing or Perfetto.');
+        }
+        catch (error) {
+            logError(error);
+            vscode.window.showErrorMessage('cfold: Could not save the trace: ' + error);
+        }
+    }
+}
\ No newline at end of file
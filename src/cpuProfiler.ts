@@ -0,0 +1,74 @@
+import * as vscode from 'vscode'
+import * as fs from 'fs';
+import * as path from 'path';
+import FoldingProvider from './foldingProvider';
+import { logError } from './logger';
+const { Session } = require('inspector');
+const { performance } = require('perf_hooks');
+
+/** Sends a command to the inspector & returns its result. */
+function post(session: any, method: string, params?: object): Promise<any> {
+    return new Promise((resolve, reject) => {
+        session.post(method, params || {}, (error: any, result: any) => {
+            if (error)
+                reject(error);
+            else
+                resolve(result);
+        });
+    });
+}
+
+/** Returns the directory of the profile, the first workspace folder or the directory of the document. */
+function getProfileDir(document: vscode.TextDocument) {
+    const folders = vscode.workspace.workspaceFolders;
+    if (folders !== undefined && folders.length > 0)
+        return folders[0].uri.fsPath;
+    return document.isUntitled ? require('os').tmpdir() : path.dirname(document.fileName);
+}
+
+/**
+ * Profiles repeated parses of the active document with the V8 CPU profiler & saves the
+ * profile, which only contains the functions of the extension, not the text of the document.
+ */
+export async function profileActiveDocument(provider: FoldingProvider) {
+    const editor = vscode.window.activeTextEditor;
+    if (editor === undefined) {
+        vscode.window.showWarningMessage('cfold: Open a document to profile its parses.');
+        return;
+    }
+    const document = editor.document;
+    const input = await vscode.window.showInputBox({
+        prompt: 'Number of parses of ' + path.basename(document.fileName),
+        value: '50',
+        validateInput: value => /^[1-9][0-9]*$/.test(value) ? '' : 'Enter a positive number',
+    });
+    if (input === undefined)
+        return;
+    const runs = Number(input);
+
+    const session = new Session();
+    session.connect();
+    try {
+        await post(session, 'Profiler.enable');
+        await post(session, 'Profiler.setSamplingInterval', { interval: 100 });
+        await post(session, 'Profiler.start');
+        const t0 = performance.now();
+        for (let i = 0; i < runs; i++)
+            provider.provideUncached(document);
+        const time = performance.now() - t0;
+        const { profile } = await post(session, 'Profiler.stop');
+
+        const name = path.basename(document.fileName).replace(/[^\w.-]/g, '_');
+        const file = path.join(getProfileDir(document), 'cfold-' + name + '-' + Date.now() + '.cpuprofile');
+        fs.writeFileSync(file, JSON.stringify(profile));
+        vscode.window.showInformationMessage('cfold: ' + runs + ' parses of ' + document.lineCount + ' lines took '
+            + (time / runs).toFixed(2) + ' ms each, saved the profile to ' + file);
+    }
+    catch (error) {
+        logError(error);
+        vscode.window.showErrorMessage('cfold: Could not profile the document: ' + error);
+    }
+    finally {
+        session.disconnect();
+    }
+}
\ No newline at end of file
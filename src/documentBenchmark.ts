@@ -0,0 +1,72 @@
+import * as vscode from 'vscode'
+import * as path from 'path';
+import FoldingProvider from './foldingProvider';
+import { g_logChannel, logForce } from './logger';
+const { performance } = require('perf_hooks');
+
+/** Times of the runs of a request & the change of the used heap. */
+class BenchmarkResult {
+    times: number[] = [];
+    heapDelta = 0;
+
+    public format(name: string, lineCount: number) {
+        const sorted = this.times.slice().sort((a, b) => a - b);
+        const mean = sorted.reduce((sum, time) => sum + time, 0) / sorted.length;
+        const at = (fraction: number) => sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * fraction))];
+        return '  ' + name + ': mean ' + mean.toFixed(3) + ' ms, median ' + at(0.5).toFixed(3)
+            + ' ms, p99 ' + at(0.99).toFixed(3) + ' ms, ' + (lineCount / mean).toFixed(0) + ' lines/ms, heap '
+            + (this.heapDelta >= 0 ? '+' : '') + (this.heapDelta / 1024).toFixed(0) + ' KiB';
+    }
+}
+
+/** Runs a request after the warm-up runs & returns the time of each run. */
+async function run(runs: number, warmUp: number, request: () => any) {
+    const result = new BenchmarkResult();
+    for (let i = 0; i < warmUp; i++)
+        await request();
+    const heap = process.memoryUsage().heapUsed;
+    for (let i = 0; i < runs; i++) {
+        const t0 = performance.now();
+        const ranges = request();
+        // Any request may resolve asynchronously, e.g. a time sliced parse or a request of the worker
+        if (ranges !== undefined && ranges !== null && typeof ranges.then === 'function')
+            await ranges;
+        result.times.push(performance.now() - t0);
+    }
+    result.heapDelta = process.memoryUsage().heapUsed - heap;
+    return result;
+}
+
+/**
+ * Times full parses of the active document & cache hits of its unchanged version & writes the
+ * times to the log channel, so the performance can be measured on documents, which can't be shared.
+ * The document isn't edited, so incremental parses aren't measured, see npm run bench:replay.
+ */
+export async function benchmarkActiveDocument(provider: FoldingProvider) {
+    const editor = vscode.window.activeTextEditor;
+    if (editor === undefined) {
+        vscode.window.showWarningMessage('cfold: Open a document to benchmark its parses.');
+        return;
+    }
+    const document = editor.document;
+    const input = await vscode.window.showInputBox({
+        prompt: 'Number of runs of ' + path.basename(document.fileName),
+        value: '100',
+        validateInput: value => /^[1-9][0-9]*$/.test(value) ? '' : 'Enter a positive number',
+    });
+    if (input === undefined)
+        return;
+    const runs = Number(input);
+    const warmUp = Math.max(5, Math.ceil(runs / 10));
+
+    await vscode.window.withProgress({ location: vscode.ProgressLocation.Notification, title: 'cfold: Benchmarking' },
+        async () => {
+            const uncached = await run(runs, warmUp, () => provider.provideUncached(document));
+            const cached = await run(runs, warmUp, () => provider.provideFoldingRanges(document));
+            logForce('benchmark of ' + document.fileName + ', ' + document.lineCount + ' lines, '
+                + runs + ' runs after ' + warmUp + ' warm-up runs');
+            logForce(uncached.format('full parse without cache', document.lineCount));
+            logForce(cached.format('cache hit of the same version', document.lineCount));
+            g_logChannel.show(true);
+        });
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+import { TextChange } from './parser';
+
+/** Changes of a single `onDidChangeTextDocument` event. */
+export interface TraceEdit {
+    /** Milliseconds since the recording started. */
+    time: number;
+    changes: TextChange[];
+}
+
+/**
+ * Recorded edits of a document, which can be replayed against the parser without vscode.
+ * The initial text is either contained or the name of a test file.
+ */
+export interface EditTrace {
+    languageId: string;
+    text?: string;
+    file?: string;
+    edits: TraceEdit[];
+}
+
+/**
+ * Returns the text after the changes of an event. The offsets refer to the text before the
+ * event, the changes are applied in the given order like vscode does, ordered from the end.
+ */
+export function applyChanges(text: string, changes: TextChange[]) {
+    for (const change of changes)
+        text = text.substring(0, change.rangeOffset) + change.text + text.substring(change.rangeOffset + change.rangeLength);
+    return text;
+}
\ No newline at end of file
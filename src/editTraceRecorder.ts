@@ -0,0 +1,78 @@
+import * as vscode from 'vscode'
+import * as fs from 'fs';
+import { EditTrace } from './editTrace';
+import { toTextChanges } from './foldingProvider';
+import { logError } from './logger';
+const { performance } = require('perf_hooks');
+
+/**
+ * Records the edits of the active C/C++ document into a trace, which the replay benchmark
+ * runs against the parser: npm run bench:replay -- <trace>
+ */
+export default class EditTraceRecorder implements vscode.Disposable {
+
+    private trace_: EditTrace | undefined = undefined;
+    private document_: vscode.TextDocument | undefined = undefined;
+    private start_ = 0;
+    private listener_: vscode.Disposable | undefined = undefined;
+
+    /** Starts recording the active document or stops & saves the recorded trace. */
+    public toggle() {
+        if (this.trace_ === undefined)
+            this.start();
+        else
+            this.stop();
+    }
+
+    public dispose() {
+        if (this.listener_ !== undefined)
+            this.listener_.dispose();
+        this.listener_ = undefined;
+        this.trace_ = undefined;
+        this.document_ = undefined;
+    }
+
+    private start() {
+        const editor = vscode.window.activeTextEditor;
+        if (editor === undefined || ['c', 'cpp'].indexOf(editor.document.languageId) < 0) {
+            vscode.window.showWarningMessage('cfold: Open a C/C++ document to record its edits.');
+            return;
+        }
+        const document = editor.document;
+        this.document_ = document;
+        this.trace_ = { languageId: document.languageId, text: document.getText(), edits: [] };
+        this.start_ = performance.now();
+        this.listener_ = vscode.workspace.onDidChangeTextDocument(this.onDidChangeTextDocument, this);
+        vscode.window.showInformationMessage('cfold: Recording the edits of ' + document.fileName
+            + ', run the command again to stop.');
+    }
+
+    private onDidChangeTextDocument(event: vscode.TextDocumentChangeEvent) {
+        if (this.trace_ === undefined || event.document !== this.document_ || event.contentChanges.length === 0)
+            return;
+        this.trace_.edits.push({ time: Math.round(performance.now() - this.start_), changes: toTextChanges(event) });
+    }
+
+    private async stop() {
+        const trace = this.trace_;
+        const document = this.document_;
+        this.dispose();
+        if (trace === undefined || document === undefined)
+            return;
+
+        const uri = await vscode.window.showSaveDialog({
+            defaultUri: document.isUntitled ? undefined : vscode.Uri.file(document.fileName + '.trace.json'),
+            filters: { 'Edit trace': ['json'] },
+        });
+        if (uri === undefined)
+            return;
+        try {
+            fs.writeFileSync(uri.fsPath, JSON.stringify(trace));
+            vscode.window.showInformationMessage('cfold: Saved ' + trace.edits.length + ' edits to ' + uri.fsPath);
+        }
+        catch (error) {
+            logError(error);
+            vscode.window.showErrorMessage('cfold: Could not save the trace: ' + error);
+        }
+    }
+}
\ No newline at end of file
@@ -2,7 +2,12 @@ import * as vscode from 'vscode'
 const pkg = require('../package.json')
 
 import FoldingProvider from './foldingProvider'
-import { g_logChannel, log, toggleLog } from './logger';
+import ChromeTraceRecorder from './chromeTraceRecorder';
+import EditTraceRecorder from './editTraceRecorder';
+import { profileActiveDocument } from './cpuProfiler';
+import { benchmarkActiveDocument } from './documentBenchmark';
+import LatencyStatusBar from './latencyStatusBar';
+import { g_logChannel, log, showLog, toggleLog } from './logger';
 import { globalConfig, updateConfig } from './globalConfig';
 
 const VERSION_ID = 'cfoldVersion'
@@ -30,6 +35,8 @@ function setup(context: vscode.ExtensionContext) {
     let provider = new FoldingProvider(false);
     let disposable;
     log('cfold initialize');
+    subscriptions.push(provider);
+    context.subscriptions.push(provider);
     subscriptions.push(disposable = g_logChannel);
     context.subscriptions.push(disposable);
     for (let name of languages) {
@@ -42,15 +49,35 @@ function setup(context: vscode.ExtensionContext) {
 
         log('register folding provider for language \'' + name + '\'');
     }
+    subscriptions.push(disposable = vscode.workspace.onDidCloseTextDocument(provider.onDidCloseTextDocument, provider));
+    context.subscriptions.push(disposable);
+    subscriptions.push(disposable = vscode.workspace.onDidChangeTextDocument(provider.onDidChangeTextDocument, provider));
+    context.subscriptions.push(disposable);
 
 
     // Register commands
     context.subscriptions.push(vscode.commands.registerCommand("cfold.toggleLog", toggleLog));
+    context.subscriptions.push(vscode.commands.registerCommand("cfold.showLog", showLog));
     context.subscriptions.push(vscode.commands.registerCommand("cfold.foldAll", provider.foldAll, provider));
     context.subscriptions.push(vscode.commands.registerCommand("cfold.foldDocComments", provider.foldDocComments, provider));
     context.subscriptions.push(vscode.commands.registerCommand("cfold.foldAroundCursor", provider.foldAroundCursor, provider));
     context.subscriptions.push(vscode.commands.registerCommand("cfold.foldFunction", provider.foldFunction, provider));
     context.subscriptions.push(vscode.commands.registerCommand("cfold.foldFunctionClassStructEnum", provider.foldFunctionClassStructEnum, provider));
+    context.subscriptions.push(vscode.commands.registerCommand("cfold.showStats", provider.showStats, provider));
+    context.subscriptions.push(vscode.commands.registerCommand("cfold.showParseCounters", provider.showParseCounters, provider));
+    context.subscriptions.push(vscode.commands.registerCommand("cfold.profileActiveDocument", () => profileActiveDocument(provider)));
+    context.subscriptions.push(vscode.commands.registerCommand("cfold.benchmarkActiveDocument", () => benchmarkActiveDocument(provider)));
+    const traceRecorder = new EditTraceRecorder();
+    subscriptions.push(traceRecorder);
+    context.subscriptions.push(traceRecorder);
+    context.subscriptions.push(vscode.commands.registerCommand("cfold.recordEditTrace", traceRecorder.toggle, traceRecorder));
+    const chromeTraceRecorder = new ChromeTraceRecorder(provider);
+    subscriptions.push(chromeTraceRecorder);
+    context.subscriptions.push(chromeTraceRecorder);
+    context.subscriptions.push(vscode.commands.registerCommand("cfold.captureTrace", chromeTraceRecorder.toggle, chromeTraceRecorder));
+    const statusBar = new LatencyStatusBar(provider.stats);
+    subscriptions.push(statusBar);
+    context.subscriptions.push(statusBar);
 
 
     // Listen to config changes
@@ -58,6 +85,8 @@ function setup(context: vscode.ExtensionContext) {
 
         if (e.affectsConfiguration('cfold')) {
             updateConfig();
+            provider.updateConfig();
+            statusBar.updateConfig();
         }
     }));
 
@@ -1,272 +1,224 @@
 import * as vscode from 'vscode'
-import { FoldingRange, FoldingRangeProvider, ProviderResult, TextDocument } from 'vscode'
-import { log } from './logger';
+import { CancellationToken, FoldingRange, FoldingRangeProvider, ProviderResult, TextDocument } from 'vscode'
+import { g_logChannel, logError, logEvent, logForce } from './logger';
+import { LogEvent } from './logBuffer';
+import Parser, { EntityType, ParseCounters, ParseJob, ParsePhase, ParseState, TextChange, setParserLog } from './parser';
+import ParseStats, { ParseRecord } from './parseStats';
+import ChromeTrace, { TraceThread } from './chromeTrace';
+import ParseCache from './parseCache';
+import ParserWorkerClient from './parserWorkerClient';
 import { globalConfig } from './globalConfig';
 const { performance } = require('perf_hooks');
 
-enum EntityType {
-    Unknown,
-    Class,
-    Comment,
-    CommentQuoteBlock,
-    CommentSlashBlock,
-    Documentation,
-    DocumentationQuoteBlock,
-    DocumentationSlashBlock,
-    Enum,
-    Function,
-    Namespace,
-    Preprocessor,
-    String,
-    StringBlock,
-    Struct,
-    WithinFunction,
-    Switch,
-    Other,
-}
+setParserLog(logEvent);
 
-class StringEntityType {
-    name: string;
-    enum_t: EntityType;
+/** Parse state & folding ranges of a single document version. */
+class DocumentState {
+    parse = new ParseState();
+    foldingRanges = new Array<FoldingRange>();
 
-    constructor(p_name: string, p_enum_t: EntityType) {
-        this.name = p_name;
-        this.enum_t = p_enum_t;
-    }
-}
+    /** Parse which is continued asynchronously. */
+    job: ParseJob | undefined = undefined;
+    promise: Promise<FoldingRange[] | undefined> | undefined = undefined;
 
-class CharInfo {
-    line: number;
-    column: number;
-    flag: number;
+    /** Work of the parses of the document, see cfold.showParseCounters. */
+    counters = new ParseCounters();
 
-    constructor(p_line: number, p_column: number, p_flag: number = 0) {
-        this.line = p_line;
-        this.column = p_column;
-        this.flag = p_flag;
+    constructor() {
+        this.parse.counters = this.counters;
     }
 }
 
-class Range {
-    startLine: number = 0;
-    startCol: number = 0;
-    endLine: number = 0;
-    endCol: number = 0;
-    scope: number = 0;
-    dist: number = 0;
-    type: EntityType = EntityType.Unknown;
+/** Creates the folding ranges of start & end lines, two entries per range. */
+function toFoldingRanges(lines: Int32Array) {
+    const foldingRanges = new Array<FoldingRange>(lines.length >> 1);
+    for (let i = 0; i < foldingRanges.length; i++)
+        foldingRanges[i] = new FoldingRange(lines[2 * i], lines[2 * i + 1]);
+    return foldingRanges;
+}
+
+/** Converts the changes of a document event, the offsets refer to the text before the event. */
+export function toTextChanges(event: vscode.TextDocumentChangeEvent) {
+    const changes = new Array<TextChange>(event.contentChanges.length);
+    for (let i = 0; i < changes.length; i++) {
+        const change = event.contentChanges[i];
+        changes[i] = {
+            startLine: change.range.start.line,
+            startCharacter: change.range.start.character,
+            endLine: change.range.end.line,
+            endCharacter: change.range.end.character,
+            text: change.text,
+            rangeOffset: change.rangeOffset,
+            rangeLength: change.rangeLength,
+        };
+    }
+    return changes;
 }
 
 export default class ConfigurableFoldingProvider implements FoldingRangeProvider {
 
     private debug_ = false;
 
-    private classEnable = false;
-
-    private commentQuoteEnable = true;
-
-    //private commentSlashEnable = true;
-
-    private documentationQuoteEnable = true;
-
-    //private documentationSlashEnable = true;
+    private parser_ = new Parser();
 
-    private enumEnable = false;
+    private parserTimeSlice = 10;
+    private parserWorker = false;
 
-    private functionEnable = true;
+    /** Last parses & cache hits per document, see cfold.showStats. */
+    public stats = new ParseStats(64);
 
-    private namespaceEnable = false;
+    /** Receives the spans of the requests & parses while a trace is captured, see cfold.captureTrace. */
+    private trace_: ChromeTrace | undefined = undefined;
+    private timePhases_ = false;
 
-    private preprocessorEnable = false;
-    private preprocessorIgnoreGuard = true
-    private preprocessorMinLines = 0;
-    private preprocessorRecursiveDepth = 1;
+    private configValid_ = false;
+    /** Incremented on configuration changes, running parses of an older configuration are dropped. */
+    private configGeneration_ = 0;
 
-    private structEnable = false;
+    /** Whether results are cached per document version, can be disabled for benchmarks. */
+    public cacheEnable = true;
+    private cache_ = new ParseCache<DocumentState>(32);
+    /** State which is re-used for every request if the cache is disabled. */
+    private uncachedState_ = new DocumentState();
 
-    private withinFunctionEnable = false;
-    private withinFunctionMinLines = 0;
+    /** Parses the documents off the extension host, if enabled. */
+    private worker_: ParserWorkerClient | undefined = undefined;
+    private workerCache_ = new ParseCache<FoldingRange[]>(32);
 
-    private caseLabelEnable = false;
-    private caseLabelMinLines = 0;
-
-    private maxElements_ = 500;
-    private rangesSearchTerm_ = new Array<StringEntityType>(
-        new StringEntityType('namespace', EntityType.Namespace),
-        new StringEntityType('class', EntityType.Class),
-        new StringEntityType('struct', EntityType.Struct),
-        new StringEntityType('enum', EntityType.Enum));
-
-    /** This range contains preprocessor directives. */
-    private preprocRanges_ = new Array<Range>(this.maxElements_);
-    private npreprocRanges_ = 0;
-
-    /** This range contains literal ranges like comments or string values. */
-    private stringRanges_ = new Array<Range>(this.maxElements_);
-    private nstringRanges_ = 0;
-
-    /** This range contains only function ranges. */
-    private funcRanges_ = new Array<Range>(this.maxElements_);
-    private nfuncRanges_ = 0;
+    constructor(debug: boolean) {
+        this.debug_ = debug;
+    }
 
-    /** This range contains only ranges within functions. */
-    private withinFuncRanges_ = new Array<Range>(this.maxElements_);
-    private nwithinFuncRanges_ = 0;
+    /** Reads the configuration, must be called after the configuration has been changed. */
+    public updateConfig() {
 
-    /** This range contains casel labels within a switch. */
-    private caseLabelRanges_ = new Array<Range>(this.maxElements_);
-    private ncaseLabelRanges_ = 0;
+        // see also setDefaultOptions()
 
-    /** This range contains namespaces, classes, structs, enums */
-    private ranges_ = new Array<Range>(this.maxElements_);
-    private nranges_ = 0;
+        const options = this.parser_.options;
+        options.classEnable = globalConfig.get('class.enable', false);
+        options.commentQuoteEnable = globalConfig.get('commentQuote.enable', true);
+        //options.commentSlashEnable = globalConfig.get('commentSlash.enable', true);
+        options.documentationQuoteEnable = globalConfig.get('documentationQuote.enable', true);
+        //options.documentationSlashEnable = globalConfig.get('documentationSlash.enable', true);
+        options.enumEnable = globalConfig.get('enum.enable', false);
+        options.functionEnable = globalConfig.get('function.enable', true);
+        options.namespaceEnable = globalConfig.get('namespace.enable', false);
+        options.preprocessorEnable = globalConfig.get('preprocessor.enable', false);
+        options.preprocessorIgnoreGuard = globalConfig.get('preprocessor.ignoreGuard', true);
+        options.preprocessorMinLines = globalConfig.get('preprocessor.minLines', 0);
+        options.preprocessorRecursiveDepth = globalConfig.get('preprocessor.recursiveDepth', 1);
+        options.structEnable = globalConfig.get('struct.enable', false);
+        options.withinFunctionEnable = globalConfig.get('withinFunction.enable', false);
+        options.withinFunctionMinLines = globalConfig.get('withinFunction.minLines', 0);
+        options.caseLabelEnable = globalConfig.get('caseLabel.enable', false);
+        options.caseLabelMinLines = globalConfig.get('caseLabel.minLines', 0);
+        this.parserTimeSlice = globalConfig.get('parser.timeSlice', 10);
+        this.parserWorker = globalConfig.get('parser.worker', false);
+        this.timePhases_ = globalConfig.get('parser.timePhases', false);
+        this.parser_.timePhases = this.timePhases_ || this.trace_ !== undefined;
 
-    constructor(debug: boolean) {
-        this.debug_ = debug;
-        for (let i = 0; i < this.maxElements_; i++) {
-            this.preprocRanges_[i] = new Range();
-            this.stringRanges_[i] = new Range();
-            this.ranges_[i] = new Range();
-            this.funcRanges_[i] = new Range();
-            this.withinFuncRanges_[i] = new Range();
-            this.caseLabelRanges_[i] = new Range();
-        }
+        // Validate config
+        if (options.preprocessorMinLines < 0)
+            options.preprocessorMinLines = 0;
+        if (options.preprocessorRecursiveDepth < 0)
+            options.preprocessorRecursiveDepth = 0;
+        if (options.withinFunctionMinLines < 0)
+            options.withinFunctionMinLines = 0;
+        if (options.caseLabelMinLines <= 0)
+            options.caseLabelMinLines = 1;
+        if (this.parserTimeSlice < 0)
+            this.parserTimeSlice = 0;
+
+        this.configValid_ = true;
+        this.configGeneration_++;
+        this.cache_.clear();
+        this.updateWorker();
     }
 
-    private inStringBlock(line: number, startCol: number, endCol: number) {
-        for (let i = 0; i < this.stringRanges_.length; i++) {
-            // Check whether line is within string bounds
-            if (line >= this.stringRanges_[i].startLine
-                && line <= this.stringRanges_[i].endLine
-                // Check whether it is within column bounds
-                && startCol >= this.stringRanges_[i].startCol
-                && endCol <= this.stringRanges_[i].endCol) {
-                return true;
-            }
-        }
-        return false;
+    /** Starts or stops capturing the spans into a trace, the phases are timed while capturing. */
+    public setTrace(trace: ChromeTrace | undefined) {
+        this.trace_ = trace;
+        this.parser_.timePhases = this.timePhases_ || trace !== undefined;
     }
 
-    private getIndicesOf(searchStr: string, str: string) {
-        var searchStrLen = searchStr.length;
-        if (searchStrLen == 0) {
-            return [];
+    /** Starts or stops the worker, a running worker re-parses all documents with the new options. */
+    private updateWorker() {
+        this.workerCache_.clear();
+        if (!this.parserWorker) {
+            this.dispose();
+            return;
         }
-        var startIndex = 0, index, indices = [];
-        while ((index = str.indexOf(searchStr, startIndex)) > -1) {
-            indices.push(index);
-            startIndex = index + searchStrLen;
+        if (this.worker_ === undefined || this.worker_.failed) {
+            this.dispose();
+            try {
+                this.worker_ = new ParserWorkerClient();
+            }
+            catch (error) {
+                logError(error);
+                return;
+            }
         }
-        return indices;
+        this.worker_.setOptions(this.parser_.options);
     }
 
-    private isEmptyOrWhitespace(str: string) {
-        return str === null || str.match(/^ *$/) !== null;
+    /** Stops the worker. */
+    public dispose() {
+        if (this.worker_ !== undefined) {
+            this.worker_.dispose();
+            this.worker_ = undefined;
+        }
     }
 
-    private isUpperCase(str: string) {
-        return str === str.toUpperCase();
+    /** Drops the cached results of a closed document. */
+    public onDidCloseTextDocument(document: TextDocument) {
+        const uri = document.uri.toString();
+        const state = this.cache_.peek(uri);
+        if (state !== undefined)
+            this.cancelParse(state);
+        this.cache_.delete(uri);
+        this.workerCache_.delete(uri);
+        this.stats.delete(uri);
+        if (this.worker_ !== undefined)
+            this.worker_.onDidCloseTextDocument(uri);
     }
 
-    private updateConfig() {
-
-        // see also setDefaultOptions()
+    /** Records the changed lines, so the next request only re-parses from the first one. */
+    public onDidChangeTextDocument(event: vscode.TextDocumentChangeEvent) {
+        const document = event.document;
+        const uri = document.uri.toString();
+        const state = this.cache_.peek(uri);
+        if (state === undefined && this.worker_ === undefined)
+            return;
 
-        this.classEnable = globalConfig.get('class.enable', false);
-        this.commentQuoteEnable = globalConfig.get('commentQuote.enable', true);
-        //this.commentSlashEnable = globalConfig.get('commentSlash.enable', true);
-        this.documentationQuoteEnable = globalConfig.get('documentationQuote.enable', true);
-        //this.documentationSlashEnable = globalConfig.get('documentationSlash.enable', true);
-        this.enumEnable = globalConfig.get('enum.enable', false);
-        this.functionEnable = globalConfig.get('function.enable', true);
-        this.namespaceEnable = globalConfig.get('namespace.enable', false);
-        this.preprocessorEnable = globalConfig.get('preprocessor.enable', false);
-        this.preprocessorIgnoreGuard = globalConfig.get('preprocessor.ignoreGuard', true);
-        this.preprocessorMinLines = globalConfig.get('preprocessor.minLines', 0);
-        this.preprocessorRecursiveDepth = globalConfig.get('preprocessor.recursiveDepth', 1);
-        this.structEnable = globalConfig.get('struct.enable', false);
-        this.withinFunctionEnable = globalConfig.get('withinFunction.enable', false);
-        this.withinFunctionMinLines = globalConfig.get('withinFunction.minLines', 0);
-        this.caseLabelEnable = globalConfig.get('caseLabel.enable', false);
-        this.caseLabelMinLines = globalConfig.get('caseLabel.minLines', 0);
+        const changes = toTextChanges(event);
+        if (this.worker_ !== undefined)
+            this.worker_.onDidChangeTextDocument(document, changes);
+        if (state === undefined)
+            return;
 
-        // Validate config
-        if (this.preprocessorMinLines < 0)
-            this.preprocessorMinLines = 0;
-        if (this.preprocessorRecursiveDepth < 0)
-            this.preprocessorRecursiveDepth = 0;
-        if (this.withinFunctionMinLines < 0)
-            this.withinFunctionMinLines = 0;
-        if (this.caseLabelMinLines <= 0)
-            this.caseLabelMinLines = 1;
+        // The result of a running parse is incomplete
+        if (state.job !== undefined) {
+            this.cancelParse(state);
+            return;
+        }
+        this.parser_.recordChanges(state.parse, document, changes);
     }
 
-    private reset() {
-        for (let i = 0; i < this.preprocRanges_.length; i++) {
-            this.preprocRanges_[i].startLine = 0;
-            this.preprocRanges_[i].startCol = 0;
-            this.preprocRanges_[i].endLine = 0;
-            this.preprocRanges_[i].endCol = 0;
-            this.preprocRanges_[i].scope = 0;
-            this.preprocRanges_[i].dist = 0;
-            this.preprocRanges_[i].type = EntityType.Unknown;
-        }
-        for (let i = 0; i < this.stringRanges_.length; i++) {
-            this.stringRanges_[i].startLine = 0;
-            this.stringRanges_[i].startCol = 0;
-            this.stringRanges_[i].endLine = 0;
-            this.stringRanges_[i].endCol = 0;
-            this.stringRanges_[i].scope = 0;
-            this.stringRanges_[i].dist = 0;
-            this.stringRanges_[i].type = EntityType.Unknown;
-        }
-        for (let i = 0; i < this.funcRanges_.length; i++) {
-            this.funcRanges_[i].startLine = 0;
-            this.funcRanges_[i].startCol = 0;
-            this.funcRanges_[i].endLine = 0;
-            this.funcRanges_[i].endCol = 0;
-            this.funcRanges_[i].scope = 0;
-            this.funcRanges_[i].dist = 0;
-            this.funcRanges_[i].type = EntityType.Unknown;
-        }
-        for (let i = 0; i < this.withinFuncRanges_.length; i++) {
-            this.withinFuncRanges_[i].startLine = 0;
-            this.withinFuncRanges_[i].startCol = 0;
-            this.withinFuncRanges_[i].endLine = 0;
-            this.withinFuncRanges_[i].endCol = 0;
-            this.withinFuncRanges_[i].scope = 0;
-            this.withinFuncRanges_[i].dist = 0;
-            this.withinFuncRanges_[i].type = EntityType.Unknown;
-        }
-        for (let i = 0; i < this.caseLabelRanges_.length; i++) {
-            this.caseLabelRanges_[i].startLine = 0;
-            this.caseLabelRanges_[i].startCol = 0;
-            this.caseLabelRanges_[i].endLine = 0;
-            this.caseLabelRanges_[i].endCol = 0;
-            this.caseLabelRanges_[i].scope = 0;
-            this.caseLabelRanges_[i].dist = 0;
-            this.caseLabelRanges_[i].type = EntityType.Unknown;
-        }
-        for (let i = 0; i < this.ranges_.length; i++) {
-            this.ranges_[i].startLine = 0;
-            this.ranges_[i].startCol = 0;
-            this.ranges_[i].endLine = 0;
-            this.ranges_[i].endCol = 0;
-            this.ranges_[i].scope = 0;
-            this.ranges_[i].dist = 0;
-            this.ranges_[i].type = EntityType.Unknown;
-        }
-        this.npreprocRanges_ = 0;
-        this.nstringRanges_ = 0;
-        this.nfuncRanges_ = 0;
-        this.nwithinFuncRanges_ = 0;
-        this.ncaseLabelRanges_ = 0;
-        this.nranges_ = 0;
+    public provideFoldingRanges(document: TextDocument, context?: vscode.FoldingContext,
+        token?: CancellationToken): ProviderResult<FoldingRange[]> {
+        const trace = this.trace_;
+        if (trace === undefined)
+            return this.provide(document, token);
+        const start = performance.now();
+        const result = this.provide(document, token);
+        trace.span('provideFoldingRanges', 'request', start, performance.now(), ChromeTrace.documentArgs(document,
+            { pending: result instanceof Promise }));
+        return result;
     }
 
-    public provideFoldingRanges(document: TextDocument): ProviderResult<FoldingRange[]> {
-        log('~~~~~~~~~~~~~~~~~~~~~~~~~~~~~provide~~~~~~~~~~~~~~~~~~~~~~~~~~~~~');
-        var t0 = performance.now();
+    private provide(document: TextDocument, token?: CancellationToken): ProviderResult<FoldingRange[]> {
+        logEvent(LogEvent.Provide);
+        const start = performance.now();
 
         const editor = vscode.window.activeTextEditor;
         if (editor === undefined && !this.debug_) {
@@ -274,636 +226,264 @@ export default class ConfigurableFoldingProvider implements FoldingRangeProvider
             return zero;
         }
 
-        this.updateConfig();
-        this.reset();
-
-        let preprocStack = new Array<CharInfo>();
-        let docStack = new Array<CharInfo>();
-        let rangeStack = new Array<CharInfo>();
-        let funcStack = new Array<CharInfo>();
-        let caseLabelStack = new Array<CharInfo>();
-
-        let startStringBlockLine = -1;
-        let startStringBlockCol = -1;
-
-        let funcCandidate = new CharInfo(-1, -1);
-        let funcBracketSet = false;
-        let funcIsCtor = false;
-        let funcSwitchSet = false;
-
-        let bracketType = EntityType.Unknown;
-
-
-        // Iterate lines of document
-        const lineCount = document.lineCount;
-        let line = "";
-        for (let i = 0; i < lineCount; i++) {
-            line = document.lineAt(i).text;
-
-
-
-
-            ////////////////////////////////////////////////
-            /// Handle preprocessor
-            ////////////////////////////////////////////////
-
-            if (this.preprocessorEnable) {
-                if (line.startsWith('#if')) {
-                    log('preproc push: [L' + i + ']' + line);
-                    let headerDef = 0;
-                    if (this.preprocessorIgnoreGuard
-                        && (line.endsWith('_HPP')
-                            || line.endsWith('_HH')
-                            || line.endsWith('_H')))
-                        headerDef = 1;
-                    preprocStack.push(new CharInfo(i, 0, headerDef));
-                }
-                else {
-                    let preprocElif = line.startsWith('#elif');
-                    let preprocElse = line.startsWith('#else');
-                    let preprocEndif = line.startsWith('#endif');
-                    if (preprocElif || preprocElse || preprocEndif) {
-                        if (preprocStack.length > 0) {
-                            let pop = preprocStack.pop() || new CharInfo(0, 0);
-                            if (this.npreprocRanges_ < this.maxElements_ && pop.flag !== 1) {
-                                let mod = 0;
-                                // Shift end to avoid slipping into the scope of #if
-                                if (preprocElif || preprocElse)
-                                    mod = 1;
-                                const idx = this.npreprocRanges_;
-                                this.preprocRanges_[idx].startLine = pop.line;
-                                this.preprocRanges_[idx].startCol = pop.column;
-                                this.preprocRanges_[idx].endLine = i - mod;
-                                this.preprocRanges_[idx].endCol = 0;
-                                this.preprocRanges_[idx].scope = preprocStack.length;
-                                this.preprocRanges_[idx].dist =
-                                    (this.preprocRanges_[idx].endLine + mod) - this.preprocRanges_[idx].startLine;
-                                this.preprocRanges_[idx].type = EntityType.Preprocessor;
-                                log('preproc block add: [L' + pop.line +
-                                    '->L' + (i - mod) + '] ' + line);
-                                this.npreprocRanges_++;
-                            }
-                        }
-                    }
-                    if (preprocElif || preprocElse) {
-                        log('preproc else(if) push: [L' + i + ']' + line);
-                        preprocStack.push(new CharInfo(i, 0));
-                    }
-                }
-            }
-
-
-
-
-            ////////////////////////////////////////////////
-            /// Handle documentation- or comment blocks
-            ////////////////////////////////////////////////
-
-            // Push & pop blocks
-            {
-                let odoc = this.getIndicesOf('/*', line);
-                let cdoc = this.getIndicesOf('*/', line);
-                for (let j = 0; j < odoc.length; j++) {
-                    let isDoc = 0;
-                    if (odoc[j] + 2 < line.length && line.charAt(odoc[j] + 2) == '*')
-                        isDoc = 1;
-                    docStack.push(new CharInfo(i, odoc[j], isDoc))
-                }
-                for (let j = 0; j < cdoc.length; j++) {
-                    if (docStack.length == 0)
-                        break;
-                    let pop = docStack.pop() || new CharInfo(0, 0);
-                    if (this.nstringRanges_ >= this.maxElements_)
-                        continue;
-                    const idx = this.nstringRanges_;
-                    this.stringRanges_[idx].startLine = pop.line;
-                    this.stringRanges_[idx].startCol = pop.column;
-                    this.stringRanges_[idx].endLine = i;
-                    this.stringRanges_[idx].endCol = cdoc[j];
-                    this.stringRanges_[idx].scope = 0;
-                    this.stringRanges_[idx].dist =
-                        this.stringRanges_[idx].endLine - this.stringRanges_[idx].startLine;
-                    this.stringRanges_[idx].type =
-                        pop.flag == 1 ? EntityType.DocumentationQuoteBlock : EntityType.CommentQuoteBlock;
-                    log('doc/comment block add: [L' + pop.line + ':' +
-                        this.stringRanges_[idx].startCol +
-                        '->L' + i + ':' + this.stringRanges_[idx].endCol + '] [TYPE:'
-                        + EntityType[this.stringRanges_[idx].type] + ']');
-                    this.nstringRanges_++;
-                }
+        if (!this.configValid_)
+            this.updateConfig();
+        if (this.worker_ !== undefined && !this.worker_.failed)
+            return this.provideFromWorker(this.worker_, document, start);
+        if (!this.cacheEnable)
+            return this.getDocumentState(document).foldingRanges;
+
+        // Re-use the results if the document hasn't been changed since the last request
+        const uri = document.uri.toString();
+        const cached = this.cache_.get(uri, document.version);
+        if (cached !== undefined) {
+            logEvent(LogEvent.CacheHit, document.version, 0, 0, 0, 0, uri);
+            this.stats.addCacheHit(uri, performance.now() - start);
+            if (this.trace_ !== undefined)
+                this.trace_.instant('cache hit', 'cache', performance.now(), ChromeTrace.documentArgs(document));
+            return cached.foldingRanges;
+        }
+
+        // Re-use the stores of an older version to avoid allocations
+        const state = this.cache_.peek(uri) || new DocumentState();
+        if (state.job !== undefined) {
+            if (state.job.version === document.version && state.promise !== undefined)
+                return state.promise;
+            this.cancelParse(state);
+        }
+
+        // Parse within the first time slice & continue asynchronously if it takes longer
+        const job = this.parser_.beginParse(document, state.parse);
+        const deadline = this.parserTimeSlice > 0 ? performance.now() + this.parserTimeSlice : Infinity;
+        if (!this.parser_.runParse(job, deadline, token)) {
+            if (job.cancelled) {
+                this.parser_.cancelParse(job);
+                this.traceCancel(job, uri);
+                return undefined;
             }
+            return this.continueParse(job, state, uri, token);
+        }
+        this.finishParse(job, state, uri);
+        this.cache_.set(uri, document.version, state);
+        return state.foldingRanges;
+    }
 
-
-
-
-            ////////////////////////////////////////////////
-            /// Handle string blocks
-            ////////////////////////////////////////////////
-
-            // Check whether the string block ends
-            if (startStringBlockLine >= 0) {
-                let endStringBlockCol = line.indexOf(')"');
-                if (endStringBlockCol !== -1) {
-                    if (this.nstringRanges_ < this.maxElements_) {
-                        log('stringblock release: [L' + i + ']' + line);
-                        const idx = this.nstringRanges_;
-                        this.stringRanges_[idx].startLine = startStringBlockLine;
-                        this.stringRanges_[idx].startCol = startStringBlockCol;
-                        this.stringRanges_[idx].endLine = i;
-                        this.stringRanges_[idx].endCol = endStringBlockCol;
-                        this.stringRanges_[idx].scope = 0;
-                        this.stringRanges_[idx].dist =
-                            this.stringRanges_[idx].endLine - this.stringRanges_[idx].startLine;
-                        this.stringRanges_[idx].type = EntityType.String;
-                        this.nstringRanges_++;
-                        startStringBlockLine = -1;
-                    }
-                }
-                else {
-                    continue;
-                }
-            }
-            // Check whether it is a start of a string block
-            {
-                startStringBlockCol = line.indexOf('R"(');
-                if (startStringBlockCol !== -1) {
-                    let endStringBlockCol = line.indexOf(')"');
-                    // Check whether it is on same line
-                    if (endStringBlockCol !== -1) {
-                        if (this.nstringRanges_ < this.maxElements_) {
-                            const idx = this.nstringRanges_;
-                            this.stringRanges_[idx].startLine = i;
-                            this.stringRanges_[idx].startCol = startStringBlockCol;
-                            this.stringRanges_[idx].endLine = i;
-                            this.stringRanges_[idx].endCol = endStringBlockCol;
-                            this.stringRanges_[idx].scope = 0;
-                            this.stringRanges_[idx].dist = 0;
-                            this.stringRanges_[idx].type = EntityType.String;
-                            log('stringblock single add: [L' + i + ':' +
-                                this.stringRanges_[idx].startCol + '->' +
-                                this.stringRanges_[idx].endCol + '] ' + line);
-                            this.nstringRanges_++;
-                        }
-                    }
-                    else {
-                        log('stringblock push: [L' + i + ']' + line);
-                        startStringBlockLine = i;
-                        continue;
-                    }
-                }
-            }
-
-
-
-
-            ////////////////////////////////////////////////
-            /// Handle single line documentation or comments
-            ////////////////////////////////////////////////
-
-            // Gather comments from current line
-            {
-                let odoc = line.indexOf('//');
-                if (odoc !== -1) {
-                    let isDoc = 0;
-                    if (odoc + 2 < line.length && line.charAt(odoc + 2) == '/')
-                        isDoc = 1;
-                    if (this.nstringRanges_ < this.maxElements_) {
-                        const idx = this.nstringRanges_;
-                        this.stringRanges_[idx].startLine = i;
-                        this.stringRanges_[idx].startCol = odoc;
-                        this.stringRanges_[idx].endLine = i;
-                        this.stringRanges_[idx].endCol = line.length;
-                        this.stringRanges_[idx].scope = 0;
-                        this.stringRanges_[idx].dist =
-                            this.stringRanges_[idx].endLine - this.stringRanges_[idx].startLine;
-                        this.stringRanges_[idx].type =
-                            isDoc ? EntityType.Documentation : EntityType.Comment;
-                        log('doc/comment single add: [L' + i + ':' +
-                            this.stringRanges_[idx].startCol + '->' +
-                            this.stringRanges_[idx].endCol + '] [TYPE:'
-                            + EntityType[this.stringRanges_[idx].type] + ']' + line);
-                        this.nstringRanges_++;
-                    }
-                }
-            }
-
-
-
-
-            ////////////////////////////////////////////////
-            /// Handle string values
-            ////////////////////////////////////////////////
-
-            // Gather string value sets from current line
-            {
-                // Search for all quote occurrences
-                let startIndex = 0;
-                let index = 0;
-                let quotes = [];
-                const quoteStr = '"';
-                const nquoteStr = quoteStr.length;
-                while ((index = line.indexOf(quoteStr, startIndex)) > -1) {
-                    if (index == 0 || line.charAt(index - 1) != '\\')
-                        quotes.push(index);
-                    startIndex = index + nquoteStr;
-                }
-                // Add quote sets
-                if (quotes.length > 1) {
-                    for (let j = 0; j < quotes.length; j = j + 2) {
-                        if (this.nstringRanges_ < this.maxElements_) {
-                            const idx = this.nstringRanges_;
-                            this.stringRanges_[idx].startLine = i;
-                            this.stringRanges_[idx].startCol = quotes[j];
-                            this.stringRanges_[idx].endLine = i;
-                            this.stringRanges_[idx].endCol = quotes[j + 1];
-                            this.stringRanges_[idx].scope = 0;
-                            this.stringRanges_[idx].dist = 0;
-                            this.stringRanges_[idx].type = EntityType.String;
-                            log('string add: [L' + i + ':' +
-                                this.stringRanges_[idx].startCol + '->' +
-                                this.stringRanges_[idx].endCol + '] ' + line);
-                            this.nstringRanges_++;
-                        }
-                    }
-                }
+    /**
+     * Requests the ranges of the document from the worker, only the folding ranges are
+     * created on the extension host. Falls back to the extension host if the worker failed.
+     */
+    private provideFromWorker(worker: ParserWorkerClient, document: TextDocument, startTime: number) {
+        const uri = document.uri.toString();
+        const version = document.version;
+        const configGeneration = this.configGeneration_;
+        if (this.cacheEnable) {
+            const cached = this.workerCache_.get(uri, version);
+            if (cached !== undefined) {
+                logEvent(LogEvent.CacheHit, version, 0, 0, 0, 0, uri);
+                this.stats.addCacheHit(uri, performance.now() - startTime);
+                if (this.trace_ !== undefined)
+                    this.trace_.instant('cache hit', 'cache', performance.now(), ChromeTrace.documentArgs(document));
+                return cached;
             }
+        }
+        const trace = this.trace_;
+        const traceId = trace !== undefined ?
+            trace.beginAsync('worker round trip', 'worker', startTime, ChromeTrace.documentArgs(document)) : 0;
+        return worker.parse(document).then(lines => {
+            if (trace !== undefined)
+                trace.endAsync(traceId, 'worker round trip', 'worker', performance.now(),
+                    { foldingRanges: lines !== undefined ? lines.length / 2 : 'none' });
+            if (lines === undefined)
+                return worker.failed ? this.getDocumentState(document).foldingRanges : undefined;
+            const foldingRanges = toFoldingRanges(lines);
+            this.stats.add(new ParseRecord(uri, version, document.lineCount, 'worker',
+                performance.now() - startTime, foldingRanges.length));
+            if (this.cacheEnable && configGeneration === this.configGeneration_)
+                this.workerCache_.set(uri, version, foldingRanges);
+            return foldingRanges;
+        });
+    }
 
-
-
-
-            ////////////////////////////////////////////////
-            /// Handle functions
-            ////////////////////////////////////////////////
-
-            // Check whether it is a function
-            if (this.functionEnable && funcCandidate.line !== -1) {
-
-                // Reset if it ends with a semicolon
-                if (!funcBracketSet && line.includes(';')) {
-                    log('func not valid [' + i + '] ' + line);
-                    funcCandidate.line = -1;
-                    funcCandidate.column = -1;
-                    funcIsCtor = false;
-                    funcStack = new Array<CharInfo>();
-                    continue;
-                }
-
-                // Check whether the function is a constructor
-                if (!funcBracketSet && line.includes(' :')) {
-                    funcIsCtor = true;
-                }
-
-                // Handle switch & case
-                if (funcStack.length > 0 && this.caseLabelEnable) {
-                    // Set switch
-                    let switch_search = ' switch ';
-                    let oswitch = line.indexOf(switch_search);
-                    if (oswitch !== -1
-                        && !this.inStringBlock(i, oswitch, oswitch + switch_search.length)) {
-                        funcSwitchSet = true;
-                    }
-                    // Push case labels
-                    else {
-                        let case_search = ' case ';
-                        let ocase = line.indexOf(case_search);
-                        if (ocase !== -1
-                            && !this.inStringBlock(i, ocase, ocase + case_search.length)) {
-
-                            if (caseLabelStack.length > 0
-                                // Check if it has the same idention
-                                && caseLabelStack[caseLabelStack.length - 1].column === ocase) {
-                                log('case pop [' + i + ']')
-
-                                let casePop = caseLabelStack.pop() || new CharInfo(0, 0);
-                                if (i - casePop.line > this.caseLabelMinLines) {
-                                    log('case add [' + casePop.line + '-' + i + '] _____' + (i - casePop.line));
-                                    // Add range
-                                    const idx = this.ncaseLabelRanges_;
-                                    this.caseLabelRanges_[idx].startLine = casePop.line;
-                                    this.caseLabelRanges_[idx].startCol = casePop.column;
-                                    this.caseLabelRanges_[idx].endLine = i - 1;
-                                    this.caseLabelRanges_[idx].endCol = ocase;
-                                    this.caseLabelRanges_[idx].scope = 0;
-                                    this.caseLabelRanges_[idx].dist =
-                                        this.caseLabelRanges_[idx].endLine - this.caseLabelRanges_[idx].startLine;
-                                    this.caseLabelRanges_[idx].type = EntityType.Switch;
-                                    this.ncaseLabelRanges_++;
-                                }
-                            }
-
-                            caseLabelStack.push(new CharInfo(i, ocase));
-                            log('case push [' + i + ']')
-                        }
-                    }
-                }
-
-                // Push open bracket
-                let obracket = this.getIndicesOf('{', line);
-                if (obracket.length > 0) {
-                    funcBracketSet = true;
-                    for (let j = 0; j < obracket.length; j++) {
-                        let funcFlag = 0;
-                        if (funcSwitchSet) {
-                            funcSwitchSet = false;
-                            funcFlag = EntityType.Switch;
-                            log('switch push { [' + i + ']')
-                        }
-                        else {
-                            log('func push { [' + i + ']')
-                        }
-                        funcStack.push(new CharInfo(i, obracket[j], funcFlag));
-                    }
-                }
-
-                // Pop close bracket
-                let cbracket = this.getIndicesOf('}', line);
-                if (cbracket.length > 0) {
-                    funcBracketSet = true;
-                    for (let j = 0; j < cbracket.length; j++) {
-                        if (funcStack.length > 0) {
-                            log('func pop  } [' + i + ']')
-                            let pop = funcStack.pop() || new CharInfo(0, 0);
-
-                            // Check whether it has the same idention
-                            if ((cbracket[j] === funcCandidate.column)
-                                || (funcIsCtor
-                                    && funcStack.length === 0
-                                    && this.isEmptyOrWhitespace(line))) {
-                                if (this.nfuncRanges_ < this.maxElements_) {
-                                    log('func add [' + pop.line + '-' + i + ']')
-                                    // Add range
-                                    const idx = this.nfuncRanges_;
-                                    this.funcRanges_[idx].startLine = pop.line;
-                                    this.funcRanges_[idx].startCol = pop.column;
-                                    this.funcRanges_[idx].endLine = i;
-                                    this.funcRanges_[idx].endCol = cbracket[j];
-                                    this.funcRanges_[idx].scope = 0;
-                                    this.funcRanges_[idx].dist =
-                                        this.funcRanges_[idx].endLine - this.funcRanges_[idx].startLine;
-                                    this.funcRanges_[idx].type = EntityType.Function;
-                                    this.nfuncRanges_++;
-                                }
-                                // Reset
-                                funcCandidate.line = -1;
-                                funcCandidate.column = -1;
-                                funcBracketSet = false;
-                                funcIsCtor = false;
-                                funcStack = new Array<CharInfo>();
-                            }
-                            // Handle brackets within function
-                            else if ((this.withinFunctionEnable || this.caseLabelEnable)
-                                && this.nwithinFuncRanges_ < this.maxElements_
-                                && cbracket[j] !== -1
-                                && cbracket[j] >= funcCandidate.column
-                                && pop.column >= funcCandidate.column
-                                && pop.line !== i
-                                && i - pop.line >= this.withinFunctionMinLines
-                                && !this.inStringBlock(pop.line, pop.column, pop.column + 1)
-                                && !this.inStringBlock(i, cbracket[j], cbracket[j] + 1)) {
-
-                                if (this.withinFunctionEnable) {
-                                    log('within func add [' + pop.line + '-' + i + ']');
-                                    // Add range
-                                    const idx = this.nwithinFuncRanges_;
-                                    this.withinFuncRanges_[idx].startLine = pop.line;
-                                    this.withinFuncRanges_[idx].startCol = pop.column;
-                                    this.withinFuncRanges_[idx].endLine = i;
-                                    this.withinFuncRanges_[idx].endCol = cbracket[j];
-                                    this.withinFuncRanges_[idx].scope = 0;
-                                    this.withinFuncRanges_[idx].dist =
-                                        this.withinFuncRanges_[idx].endLine - this.withinFuncRanges_[idx].startLine;
-                                    this.withinFuncRanges_[idx].type = EntityType.WithinFunction;
-                                    this.nwithinFuncRanges_++;
-                                }
-
-                                if (this.caseLabelEnable) {
-                                    // Check if it is the last case label in the switch
-                                    if (caseLabelStack.length > 0 && pop.flag === EntityType.Switch) {
-                                        log('last case pop [' + i + ']')
-
-                                        let casePop = caseLabelStack.pop() || new CharInfo(0, 0);
-                                        if (i - casePop.line > this.caseLabelMinLines) {
-                                            log('last case add [' + casePop.line + '-' + i + ']');
-                                            // Add range
-                                            const idx = this.ncaseLabelRanges_;
-                                            this.caseLabelRanges_[idx].startLine = casePop.line;
-                                            this.caseLabelRanges_[idx].startCol = casePop.column;
-                                            this.caseLabelRanges_[idx].endLine = i - 1;
-                                            this.caseLabelRanges_[idx].endCol = cbracket[j];
-                                            this.caseLabelRanges_[idx].scope = 0;
-                                            this.caseLabelRanges_[idx].dist =
-                                                this.caseLabelRanges_[idx].endLine - this.caseLabelRanges_[idx].startLine;
-                                            this.caseLabelRanges_[idx].type = EntityType.Switch;
-                                            this.ncaseLabelRanges_++;
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
+    /** Runs the remaining time slices of a parse, other events are handled in between. */
+    private continueParse(job: ParseJob, state: DocumentState, uri: string, token?: CancellationToken) {
+        const configGeneration = this.configGeneration_;
+        state.job = job;
+        state.promise = new Promise<FoldingRange[] | undefined>(resolve => {
+            const step = () => {
+                if (job.cancelled || configGeneration !== this.configGeneration_
+                    || (token !== undefined && token.isCancellationRequested)) {
+                    logEvent(LogEvent.ParseCancelled, job.version, job.next);
+                    this.traceCancel(job, uri);
+                    if (state.job === job)
+                        this.cancelParse(state);
+                    else
+                        this.parser_.cancelParse(job);
+                    resolve(undefined);
+                    return;
                 }
-                continue;
-            }
-
-            // Check whether it is a start of a function
-            if (this.functionEnable && funcCandidate.line === -1 && docStack.length === 0) {
-                let obrace = line.indexOf('(');
-                if (obrace !== -1 && !line.includes(';')) {
-                    let objects = line.match(/\S+/g) || [];
-                    let inString = false;
-                    // Check if found block with open brace is in string block
-                    let objIdx = -1;
-                    let objColumn = -1;
-                    for (let j = 0; j < objects.length; j++) {
-                        objColumn = objects[j].indexOf('(');
-                        if (objColumn !== -1) {
-                            objIdx = j;
-                            let startObjIdx = line.indexOf(objects[j]);
-                            let endObjIdx = startObjIdx + objects[j].length;
-                            if (this.inStringBlock(i, startObjIdx, endObjIdx)) {
-                                log('func in string [' + i + ':' + startObjIdx + '-' + endObjIdx + '] ' + line);
-                                inString = true;
-                            }
-                            break;
-                        }
-                    }
-                    if (objects.length > 0 && !inString
-                        // This shouldn't happen anyway
-                        && objIdx !== -1 && objColumn !== -1) {
-                        // Check whether it is a macro function call
-                        if (this.isUpperCase(objects[objIdx].substr(0, objColumn))) {
-                            log('func is macro [' + i + '] ' + line);
-                            continue;
-                        }
-                        let funcLine = i;
-                        let funcLineText = line;
-                        let braceStack = 0;
-
-                        // Iterate til to the end of the curly brace
-                        for (i = i; i < lineCount; i++) {
-                            line = document.lineAt(i).text;
-                            braceStack = braceStack + (line.split('(').length - 1);
-                            braceStack = braceStack - (line.split(')').length - 1);
-                            if (braceStack > 0)
-                                continue;
-                            else
-                                break;
-                        }
-
-                        // Check again for semicolon at the end of curly brace
-                        if (line.includes(';'))
-                            continue;
-
-                        // Skip one-liner
-                        let bopen = this.getIndicesOf('{', line);
-                        let bclose = this.getIndicesOf('}', line);
-                        if (bopen.length > 0 && bopen.length === bclose.length)
-                            continue;
-
-                        // Probably in function
-                        funcCandidate.line = funcLine;
-                        funcCandidate.column = funcLineText.indexOf(objects[0]);
-                        log('func candidate detect [' + funcCandidate.line + ':' + funcCandidate.column + '] ' + funcLineText);
-
-                        // Push open brackets
-                        if (bopen.length !== -1) {
-                            funcBracketSet = true;
-                            for (let j = 0; j < bopen.length; j++) {
-                                log('_func push { [' + i + ']')
-                                funcStack.push(new CharInfo(i, bopen[j]));
-                            }
-                        }
-                        // Pop close brackets
-                        if (bopen.length !== -1) {
-                            funcBracketSet = true;
-                            for (let j = 0; j < bclose.length; j++) {
-                                if (funcStack.length == 0)
-                                    break;
-                                log('_func pop  } [' + i + ']')
-                                funcStack.pop() || new CharInfo(0, 0);
-                            }
-                        }
-
-                        // Check whether the function is a constructor
-                        if (line.includes(' :')) {
-                            funcIsCtor = true;
-                        }
-                        continue;
-                    }
+                const start = performance.now();
+                const done = this.parser_.runParse(job, start + this.parserTimeSlice, token);
+                if (this.trace_ !== undefined)
+                    this.trace_.span('parse slice', 'parse', start, performance.now(), { uri: uri, version: job.version, next: job.next });
+                if (!done) {
+                    setImmediate(step);
+                    return;
                 }
-            }
-
-
+                state.job = undefined;
+                state.promise = undefined;
+                this.finishParse(job, state, uri);
+                this.cache_.set(uri, job.version, state);
+                resolve(state.foldingRanges);
+            };
+            setImmediate(step);
+        });
+        return state.promise;
+    }
 
+    /** Adds the cancellation of a parse to the trace. */
+    private traceCancel(job: ParseJob, uri: string) {
+        if (this.trace_ !== undefined)
+            this.trace_.instant('parse cancelled', 'parse', performance.now(),
+                { uri: uri, version: job.version, lineCount: job.lineCount, next: job.next });
+    }
 
-            // After this line non-functions brackets are available.
-            // To correctly process brackets, it needs to push & pop them all
-            {
-                // Set identifier for the next bracket
-                for (let term of this.rangesSearchTerm_) {
-                    let idx = line.indexOf(term.name);
-                    if (idx !== -1
-                        && !this.inStringBlock(i, idx, idx + term.name.length)) {
-                        bracketType = term.enum_t;
-                        break;
-                    }
-                }
-                // Invalidate identifier if semicolon is found
-                if (bracketType !== EntityType.Unknown) {
-                    if (line.includes(';')) {
-                        bracketType = EntityType.Unknown;
-                    }
-                }
-            }
+    /** Stops the running parse of a document, the next parse of the document is a full parse. */
+    private cancelParse(state: DocumentState) {
+        if (state.job === undefined)
+            return;
+        this.parser_.cancelParse(state.job);
+        state.job = undefined;
+        state.promise = undefined;
+    }
 
+    /**
+     * Returns the state of the current document version.
+     * The document is only parsed if there is no cached state for this version.
+     */
+    private getDocumentState(document: TextDocument) {
+        if (!this.configValid_)
+            this.updateConfig();
+        const uri = document.uri.toString();
+
+        if (!this.cacheEnable) {
+            this.provideUncached(document);
+            return this.uncachedState_;
+        }
+
+        // Re-use the results if the document hasn't been changed since the last request
+        const cached = this.cache_.get(uri, document.version);
+        if (cached !== undefined) {
+            logEvent(LogEvent.CacheHit, document.version, 0, 0, 0, 0, uri);
+            if (this.trace_ !== undefined)
+                this.trace_.instant('cache hit', 'cache', performance.now(), ChromeTrace.documentArgs(document));
+            return cached;
+        }
+
+        // Re-use the stores of an older version to avoid allocations
+        const state = this.cache_.peek(uri) || new DocumentState();
+        this.cancelParse(state);
+        this.parseDocument(document, state, uri);
+        this.cache_.set(uri, document.version, state);
+        return state;
+    }
 
+    /** Parses the whole document on the extension host, without the cache & the worker, e.g. for profiles. */
+    public provideUncached(document: TextDocument) {
+        if (!this.configValid_)
+            this.updateConfig();
+        this.uncachedState_.parse.editVersion = -1;
+        this.parseDocument(document, this.uncachedState_, document.uri.toString());
+        return this.uncachedState_.foldingRanges;
+    }
 
+    /** Parses the document into the state without interruption. */
+    private parseDocument(document: TextDocument, state: DocumentState, uri: string) {
+        const job = this.parser_.beginParse(document, state.parse);
+        this.parser_.runParse(job, Infinity);
+        this.finishParse(job, state, uri);
+    }
 
-            ////////////////////////////////////////////////
-            /// Handle namespaces, structs, classes, enums
-            ////////////////////////////////////////////////
+    /** Applies the parsed lines of a finished job & adds the enabled ranges to new folding ranges. */
+    private finishParse(job: ParseJob, state: DocumentState, uri: string) {
+        this.parser_.finishParse(job);
+        const t0 = performance.now();
+        state.foldingRanges = toFoldingRanges(this.parser_.getFoldingLines(state.parse.result));
+        const t1 = performance.now();
+
+        const kind = !job.reparse ? 'shift' : job.from > 0 ? 'incremental' : 'full';
+        const record = new ParseRecord(uri, job.version, job.lineCount, kind, t1 - job.startTime,
+            state.foldingRanges.length);
+        record.setRanges(state.parse.result);
+        if (job.phaseTimes !== undefined) {
+            job.phaseTimes[ParsePhase.Emit] = t1 - t0;
+            record.phaseTimes = job.phaseTimes;
+        }
+        this.stats.add(record);
+        if (this.trace_ !== undefined)
+            this.traceParse(this.trace_, job, record, t1);
+    }
 
-            {
-                let obracket = this.getIndicesOf('{', line);
-                let cbracket = this.getIndicesOf('}', line);
-                for (let j = 0; j < obracket.length; j++) {
-                    log('range push { [' + i + '] [TYPE:'
-                        + EntityType[bracketType] + ']')
-                    rangeStack.push(new CharInfo(i, obracket[j], bracketType))
-                }
-                for (let j = 0; j < cbracket.length; j++) {
-                    if (rangeStack.length == 0)
-                        break;
-                    let pop = rangeStack.pop() || new CharInfo(0, 0);
-                    if (this.nranges_ >= this.maxElements_)
-                        continue;
-                    const idx = this.nranges_;
-                    this.ranges_[idx].startLine = pop.line;
-                    this.ranges_[idx].startCol = pop.column;
-                    this.ranges_[idx].endLine = i;
-                    this.ranges_[idx].endCol = cbracket[j];
-                    this.ranges_[idx].scope = 0;
-                    this.ranges_[idx].dist =
-                        this.ranges_[idx].endLine - this.ranges_[idx].startLine;
-                    this.ranges_[idx].type = pop.flag;
-                    log('range add: [L' + pop.line + ':' +
-                        this.ranges_[idx].startCol +
-                        '->L' + i + ':' + this.ranges_[idx].endCol + '] [TYPE:'
-                        + EntityType[this.ranges_[idx].type] + ']');
-                    this.nranges_++;
-                }
-            }
+    /**
+     * Adds the parse as a span, which may contain time slices of other work, & its phases.
+     * A phase is accumulated over the lines, so the phases are consecutive spans of their total time.
+     */
+    private traceParse(trace: ChromeTrace, job: ParseJob, record: ParseRecord, end: number) {
+        const args = ChromeTrace.documentArgs({ uri: record.uri, version: record.version, lineCount: record.lineCount },
+            { foldingRanges: record.foldingRanges, from: job.from, end: job.end });
+        const id = trace.beginAsync('parse ' + record.kind, 'parse', job.startTime, args);
+        trace.endAsync(id, 'parse ' + record.kind, 'parse', end);
+        const phaseTimes = job.phaseTimes;
+        if (phaseTimes === undefined)
+            return;
+        let start = job.startTime;
+        for (let phase = 0; phase < ParsePhase.Count; phase++) {
+            trace.span(ParsePhase[phase], 'phase', start, start + phaseTimes[phase], { uri: record.uri, version: record.version },
+                TraceThread.Phases);
+            start += phaseTimes[phase];
         }
+    }
 
 
+    /** Returns the parse result of the active document, parses it if the cache is stale. */
+    private getActiveResult() {
+        const editor = vscode.window.activeTextEditor;
+        if (editor === undefined || !editor.selection.isEmpty)
+            return undefined;
+        return this.getDocumentState(editor.document).parse.result;
+    }
 
+    /** Writes the last parses of the active document to the log channel. */
+    public showStats() {
+        const editor = vscode.window.activeTextEditor;
+        if (editor === undefined)
+            return;
+        logForce('parse stats of ' + editor.document.fileName);
+        for (const line of this.stats.format(editor.document.uri.toString()))
+            logForce(line);
+        g_logChannel.show(true);
+    }
 
-        ////////////////////////////////////////////////
-        /// Add the found ranges to a new folding range
-        ////////////////////////////////////////////////
-
-        // Todo maybe store them and re-use later
-        const foldingRanges = new Array<FoldingRange>();
-        if (this.preprocessorEnable) {
-            for (let i = 0; i < this.npreprocRanges_; i++) {
-                if (this.preprocRanges_[i].scope <= this.preprocessorRecursiveDepth
-                    && this.preprocRanges_[i].dist >= this.preprocessorMinLines)
-                    foldingRanges.push(
-                        new FoldingRange(this.preprocRanges_[i].startLine, this.preprocRanges_[i].endLine));
-            }
-        }
-        for (let i = 0; i < this.nranges_; i++) {
-            if ((this.namespaceEnable && this.ranges_[i].type === EntityType.Namespace)
-                || (this.classEnable && this.ranges_[i].type === EntityType.Class)
-                || (this.structEnable && this.ranges_[i].type === EntityType.Struct)
-                || (this.enumEnable && this.ranges_[i].type === EntityType.Enum))
-                foldingRanges.push(
-                    new FoldingRange(this.ranges_[i].startLine, this.ranges_[i].endLine));
-        }
-        for (let i = 0; i < this.nstringRanges_; i++) {
-            if ((this.documentationQuoteEnable && this.stringRanges_[i].type === EntityType.DocumentationQuoteBlock)
-                || (this.commentQuoteEnable && this.stringRanges_[i].type === EntityType.CommentQuoteBlock))
-                foldingRanges.push(
-                    new FoldingRange(this.stringRanges_[i].startLine, this.stringRanges_[i].endLine));
-        }
-        for (let i = 0; i < this.nfuncRanges_; i++) {
-            foldingRanges.push(
-                new FoldingRange(this.funcRanges_[i].startLine, this.funcRanges_[i].endLine));
-        }
-        for (let i = 0; i < this.nwithinFuncRanges_; i++) {
-            foldingRanges.push(
-                new FoldingRange(this.withinFuncRanges_[i].startLine, this.withinFuncRanges_[i].endLine));
-        }
-        // Double inserts doesn't seem to affect the folding at all
-        for (let i = 0; i < this.ncaseLabelRanges_; i++) {
-            foldingRanges.push(
-                new FoldingRange(this.caseLabelRanges_[i].startLine, this.caseLabelRanges_[i].endLine));
+    /** Writes the work of the parses of the active document to the log channel. */
+    public showParseCounters() {
+        const editor = vscode.window.activeTextEditor;
+        if (editor === undefined)
+            return;
+        const state = this.cache_.peek(editor.document.uri.toString());
+        if (state === undefined || this.worker_ !== undefined) {
+            vscode.window.showInformationMessage('cfold: The active document hasn\'t been parsed on the extension host.');
+            return;
         }
-
-
-        var t1 = performance.now();
-        log('finished in ' + lineCount + ' lines in ' + (t1 - t0) + 'ms')
-        return foldingRanges;
+        const c = state.counters;
+        const perLine = (value: number) => (c.linesLexed === 0 ? 0 : value / c.linesLexed).toFixed(2);
+        logForce('parse counters of ' + editor.document.fileName);
+        logForce('  parses: ' + c.parses + ' (' + c.incrementalParses + ' incremental)');
+        logForce('  input chars of full parses: ' + c.inputChars + ', indexed: ' + c.charsIndexed
+            + ', visits per char: ' + c.charVisitsPerChar().toFixed(2));
+        logForce('  lexed lines: ' + c.linesLexed + ', chars: ' + c.charsLexed + ', tokens: ' + c.tokens
+            + ' (' + perLine(c.tokens) + ' per line)');
+        logForce('  stack pushes: ' + c.stackPushes + ', pops: ' + c.stackPops
+            + ', ranges added: ' + c.rangesAdded + ' (' + perLine(c.rangesAdded) + ' per line)');
+        g_logChannel.show(true);
     }
 
     public async foldAll() {
@@ -911,17 +491,17 @@ export default class ConfigurableFoldingProvider implements FoldingRangeProvider
     }
 
     public async foldDocComments() {
-        if (vscode.window.activeTextEditor === undefined
-            || !vscode.window.activeTextEditor.selection.isEmpty)
+        const result = this.getActiveResult();
+        if (result === undefined)
             return;
         let lines: number[] = [];
 
-        for (let i = 0; i < this.nstringRanges_; i++) {
-            if (this.stringRanges_[i].type === EntityType.DocumentationQuoteBlock
-                || this.stringRanges_[i].type === EntityType.CommentQuoteBlock) {
-                //log('foldDocComments: [L' + this.stringRanges_[i].startLine + "] [TYPE:"
-                //    + EntityType[this.stringRanges_[i].type] + "]");
-                lines.push(this.stringRanges_[i].startLine);
+        for (let i = 0; i < result.stringRanges.length; i++) {
+            if (result.stringRanges.type[i] === EntityType.DocumentationQuoteBlock
+                || result.stringRanges.type[i] === EntityType.CommentQuoteBlock) {
+                //log('foldDocComments: [L' + result.stringRanges.startLine[i] + "] [TYPE:"
+                //    + EntityType[result.stringRanges.type[i]] + "]");
+                lines.push(result.stringRanges.startLine[i]);
             }
         }
 
@@ -930,62 +510,64 @@ export default class ConfigurableFoldingProvider implements FoldingRangeProvider
     }
 
     public async foldAroundCursor() {
-        if (vscode.window.activeTextEditor === undefined
-            || !vscode.window.activeTextEditor.selection.isEmpty)
+        const result = this.getActiveResult();
+        if (result === undefined || vscode.window.activeTextEditor === undefined)
             return;
+        const options = this.parser_.options;
         let lines: number[] = [];
         let cursorPos = vscode.window.activeTextEditor.selection.active;
 
-        if (this.preprocessorEnable) {
-            for (let i = 0; i < this.npreprocRanges_; i++) {
-                if (this.preprocRanges_[i].scope <= this.preprocessorRecursiveDepth
-                    && this.preprocRanges_[i].dist >= this.preprocessorMinLines)
-                    if (!(cursorPos.line >= this.preprocRanges_[i].startLine && cursorPos.line <= this.preprocRanges_[i].endLine)) {
-                        //log('foldAroundCursor->preprocRanges_: [L' + this.preprocRanges_[i].startLine + "] [TYPE:"
-                        //    + EntityType[this.preprocRanges_[i].type] + "]");
-                        lines.push(this.preprocRanges_[i].startLine);
+        if (options.preprocessorEnable) {
+            for (let i = 0; i < result.preprocRanges.length; i++) {
+                if (result.preprocRanges.scope[i] <= options.preprocessorRecursiveDepth
+                    && result.preprocRanges.dist[i] >= options.preprocessorMinLines)
+                    if (!(cursorPos.line >= result.preprocRanges.startLine[i] && cursorPos.line <= result.preprocRanges.endLine[i])) {
+                        //log('foldAroundCursor->preprocRanges_: [L' + result.preprocRanges.startLine[i] + "] [TYPE:"
+                        //    + EntityType[result.preprocRanges.type[i]] + "]");
+                        lines.push(result.preprocRanges.startLine[i]);
                     }
             }
         }
-        for (let i = 0; i < this.nranges_; i++) {
-            if ((this.namespaceEnable && this.ranges_[i].type === EntityType.Namespace)
-                || (this.classEnable && this.ranges_[i].type === EntityType.Class)
-                || (this.structEnable && this.ranges_[i].type === EntityType.Struct)
-                || (this.enumEnable && this.ranges_[i].type === EntityType.Enum))
-                if (!(cursorPos.line >= this.ranges_[i].startLine && cursorPos.line <= this.ranges_[i].endLine)) {
-                    //log('foldAroundCursor->ranges_: [L' + this.ranges_[i].startLine + "] [TYPE:"
-                    //    + EntityType[this.ranges_[i].type] + "]");
-                    lines.push(this.ranges_[i].startLine);
+        for (let i = 0; i < result.ranges.length; i++) {
+            if ((options.namespaceEnable && result.ranges.type[i] === EntityType.Namespace)
+                || (options.classEnable && result.ranges.type[i] === EntityType.Class)
+                || (options.structEnable && result.ranges.type[i] === EntityType.Struct)
+                || (options.enumEnable && result.ranges.type[i] === EntityType.Enum))
+                if (!(cursorPos.line >= result.ranges.startLine[i] && cursorPos.line <= result.ranges.endLine[i])) {
+                    //log('foldAroundCursor->ranges_: [L' + result.ranges.startLine[i] + "] [TYPE:"
+                    //    + EntityType[result.ranges.type[i]] + "]");
+                    lines.push(result.ranges.startLine[i]);
                 }
         }
-        for (let i = 0; i < this.nstringRanges_; i++) {
-            if ((this.documentationQuoteEnable && this.stringRanges_[i].type === EntityType.DocumentationQuoteBlock)
-                || (this.commentQuoteEnable && this.stringRanges_[i].type === EntityType.CommentQuoteBlock))
-                if (!(cursorPos.line >= this.stringRanges_[i].startLine && cursorPos.line <= this.stringRanges_[i].endLine)) {
-                    //log('foldAroundCursor->stringRanges_: [L' + this.stringRanges_[i].startLine + "] [TYPE:"
-                    //    + EntityType[this.stringRanges_[i].type] + "]");
-                    lines.push(this.stringRanges_[i].startLine);
+        for (let i = 0; i < result.stringRanges.length; i++) {
+            if ((options.documentationQuoteEnable && result.stringRanges.type[i] === EntityType.DocumentationQuoteBlock)
+                || (options.commentQuoteEnable && result.stringRanges.type[i] === EntityType.CommentQuoteBlock))
+                if (!(cursorPos.line >= result.stringRanges.startLine[i] && cursorPos.line <= result.stringRanges.endLine[i])) {
+                    //log('foldAroundCursor->stringRanges_: [L' + result.stringRanges.startLine[i] + "] [TYPE:"
+                    //    + EntityType[result.stringRanges.type[i]] + "]");
+                    lines.push(result.stringRanges.startLine[i]);
                 }
         }
-        for (let i = 0; i < this.nfuncRanges_; i++) {
-            if (!(cursorPos.line >= this.funcRanges_[i].startLine && cursorPos.line <= this.funcRanges_[i].endLine)) {
-                //log('foldAroundCursor->funcRanges_: [L' + this.funcRanges_[i].startLine + "] [TYPE:"
-                //    + EntityType[this.funcRanges_[i].type] + "]");
-                lines.push(this.funcRanges_[i].startLine);
+        for (let i = 0; i < result.funcRanges.length; i++) {
+            if (!(cursorPos.line >= result.funcRanges.startLine[i] && cursorPos.line <= result.funcRanges.endLine[i])) {
+                //log('foldAroundCursor->funcRanges_: [L' + result.funcRanges.startLine[i] + "] [TYPE:"
+                //    + EntityType[result.funcRanges.type[i]] + "]");
+                lines.push(result.funcRanges.startLine[i]);
             }
         }
-        for (let i = 0; i < this.nwithinFuncRanges_; i++) {
-            if (!(cursorPos.line >= this.withinFuncRanges_[i].startLine && cursorPos.line <= this.withinFuncRanges_[i].endLine)) {
-                //log('foldAroundCursor->withinFuncRanges_: [L' + this.withinFuncRanges_[i].startLine + "] [TYPE:"
-                //    + EntityType[this.withinFuncRanges_[i].type] + "]");
-                lines.push(this.withinFuncRanges_[i].startLine);
+        for (let i = 0; i < result.withinFuncRanges.length; i++) {
+            if (!(cursorPos.line >= result.withinFuncRanges.startLine[i] && cursorPos.line <= result.withinFuncRanges.endLine[i])) {
+                //log('foldAroundCursor->withinFuncRanges_: [L' + result.withinFuncRanges.startLine[i] + "] [TYPE:"
+                //    + EntityType[result.withinFuncRanges.type[i]] + "]");
+                lines.push(result.withinFuncRanges.startLine[i]);
             }
         }
-        for (let i = 0; i < this.ncaseLabelRanges_; i++) {
-            if (!(cursorPos.line >= this.caseLabelRanges_[i].startLine && cursorPos.line <= this.caseLabelRanges_[i].endLine)) {
-                //log('foldAroundCursor->caseLabelRanges_: [L' + this.caseLabelRanges_[i].startLine + "] [TYPE:"
-                //    + EntityType[this.caseLabelRanges_[i].type] + "]");
-                lines.push(this.caseLabelRanges_[i].startLine);
+        for (let i = 0; i < result.caseLabelRanges.length; i++) {
+            if (result.caseLabelRanges.dist[i] >= options.caseLabelMinLines
+                && !(cursorPos.line >= result.caseLabelRanges.startLine[i] && cursorPos.line <= result.caseLabelRanges.endLine[i])) {
+                //log('foldAroundCursor->caseLabelRanges_: [L' + result.caseLabelRanges.startLine[i] + "] [TYPE:"
+                //    + EntityType[result.caseLabelRanges.type[i]] + "]");
+                lines.push(result.caseLabelRanges.startLine[i]);
             }
         }
 
@@ -994,19 +576,21 @@ export default class ConfigurableFoldingProvider implements FoldingRangeProvider
     }
 
     public async foldFunction() {
-        if (vscode.window.activeTextEditor === undefined
-            || !vscode.window.activeTextEditor.selection.isEmpty)
+        const result = this.getActiveResult();
+        if (result === undefined)
             return;
+        const options = this.parser_.options;
         let lines: number[] = [];
 
-        for (let i = 0; i < this.nfuncRanges_; i++) {
-            lines.push(this.funcRanges_[i].startLine);
+        for (let i = 0; i < result.funcRanges.length; i++) {
+            lines.push(result.funcRanges.startLine[i]);
         }
-        for (let i = 0; i < this.nwithinFuncRanges_; i++) {
-            lines.push(this.withinFuncRanges_[i].startLine);
+        for (let i = 0; i < result.withinFuncRanges.length; i++) {
+            lines.push(result.withinFuncRanges.startLine[i]);
         }
-        for (let i = 0; i < this.ncaseLabelRanges_; i++) {
-            lines.push(this.caseLabelRanges_[i].startLine);
+        for (let i = 0; i < result.caseLabelRanges.length; i++) {
+            if (result.caseLabelRanges.dist[i] >= options.caseLabelMinLines)
+                lines.push(result.caseLabelRanges.startLine[i]);
         }
 
         if (lines.length > 1)
@@ -1014,26 +598,28 @@ export default class ConfigurableFoldingProvider implements FoldingRangeProvider
     }
 
     public async foldFunctionClassStructEnum() {
-        if (vscode.window.activeTextEditor === undefined
-            || !vscode.window.activeTextEditor.selection.isEmpty)
+        const result = this.getActiveResult();
+        if (result === undefined)
             return;
+        const options = this.parser_.options;
         let lines: number[] = [];
 
-        for (let i = 0; i < this.nfuncRanges_; i++) {
-            lines.push(this.funcRanges_[i].startLine);
+        for (let i = 0; i < result.funcRanges.length; i++) {
+            lines.push(result.funcRanges.startLine[i]);
         }
-        for (let i = 0; i < this.nwithinFuncRanges_; i++) {
-            lines.push(this.withinFuncRanges_[i].startLine);
+        for (let i = 0; i < result.withinFuncRanges.length; i++) {
+            lines.push(result.withinFuncRanges.startLine[i]);
         }
-        for (let i = 0; i < this.ncaseLabelRanges_; i++) {
-            lines.push(this.caseLabelRanges_[i].startLine);
+        for (let i = 0; i < result.caseLabelRanges.length; i++) {
+            if (result.caseLabelRanges.dist[i] >= options.caseLabelMinLines)
+                lines.push(result.caseLabelRanges.startLine[i]);
         }
-        for (let i = 0; i < this.nranges_; i++) {
-            if ((this.namespaceEnable && this.ranges_[i].type === EntityType.Namespace)
-                || (this.classEnable && this.ranges_[i].type === EntityType.Class)
-                || (this.structEnable && this.ranges_[i].type === EntityType.Struct)
-                || (this.enumEnable && this.ranges_[i].type === EntityType.Enum))
-                lines.push(this.ranges_[i].startLine);
+        for (let i = 0; i < result.ranges.length; i++) {
+            if ((options.namespaceEnable && result.ranges.type[i] === EntityType.Namespace)
+                || (options.classEnable && result.ranges.type[i] === EntityType.Class)
+                || (options.structEnable && result.ranges.type[i] === EntityType.Struct)
+                || (options.enumEnable && result.ranges.type[i] === EntityType.Enum))
+                lines.push(result.ranges.startLine[i]);
         }
 
         if (lines.length > 1)
@@ -0,0 +1,75 @@
+import * as vscode from 'vscode'
+import ParseStats from './parseStats';
+import { globalConfig } from './globalConfig';
+
+/**
+ * Status bar item with the latency of the last request of the active document & whether it
+ * was a cache hit, an incremental or a full parse. Opens cfold.showStats on click.
+ */
+export default class LatencyStatusBar implements vscode.Disposable {
+
+    private item_: vscode.StatusBarItem;
+    private stats_: ParseStats;
+    private listener_: vscode.Disposable | undefined = undefined;
+    private enable_ = false;
+
+    /** Milliseconds of a request, above which the item has the warning color. */
+    private budget_ = 20;
+
+    constructor(p_stats: ParseStats) {
+        this.stats_ = p_stats;
+        this.item_ = vscode.window.createStatusBarItem(vscode.StatusBarAlignment.Right, 100);
+        this.item_.command = 'cfold.showStats';
+        this.updateConfig();
+    }
+
+    /** Reads the configuration, must be called after the configuration has been changed. */
+    public updateConfig() {
+        this.enable_ = globalConfig.get('statusBar.enable', false);
+        this.budget_ = globalConfig.get('statusBar.latencyBudget', 20);
+        if (!this.enable_) {
+            this.stats_.onChange = undefined;
+            if (this.listener_ !== undefined)
+                this.listener_.dispose();
+            this.listener_ = undefined;
+            this.item_.hide();
+            return;
+        }
+        this.stats_.onChange = uri => {
+            const editor = vscode.window.activeTextEditor;
+            if (editor !== undefined && editor.document.uri.toString() === uri)
+                this.update();
+        };
+        if (this.listener_ === undefined)
+            this.listener_ = vscode.window.onDidChangeActiveTextEditor(this.update, this);
+        this.update();
+    }
+
+    public dispose() {
+        this.stats_.onChange = undefined;
+        if (this.listener_ !== undefined)
+            this.listener_.dispose();
+        this.listener_ = undefined;
+        this.item_.dispose();
+    }
+
+    private update() {
+        const editor = vscode.window.activeTextEditor;
+        const uri = editor !== undefined ? editor.document.uri.toString() : '';
+        const record = this.stats_.last(uri);
+        const hitTime = this.stats_.lastHitTime(uri);
+        if (record === undefined && hitTime < 0) {
+            this.item_.hide();
+            return;
+        }
+
+        const time = hitTime >= 0 ? hitTime : record !== undefined ? record.time : 0;
+        const kind = hitTime >= 0 ? 'cache' : record !== undefined ? record.kind : '';
+        this.item_.text = '$(fold) ' + time.toFixed(1) + ' ms ' + kind;
+        this.item_.tooltip = 'cfold: last request took ' + time.toFixed(2) + ' ms (' + kind + ')'
+            + (record !== undefined ? ', last parse ' + record.format() : '')
+            + '\nClick to show the last parses';
+        this.item_.backgroundColor = time > this.budget_ ? new vscode.ThemeColor('statusBarItem.warningBackground') : undefined;
+        this.item_.show();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,495 @@
+/** Token types emitted by the lexer. */
+export enum TokenType {
+    OpenBrace,
+    CloseBrace,
+    OpenParen,
+    CloseParen,
+    Semicolon,
+    Namespace,
+    Class,
+    Struct,
+    Enum,
+    Switch,
+    Case,
+    Directive,
+    CommentOpen,
+    DocCommentOpen,
+    LineCommentOpen,
+    DocLineCommentOpen,
+    StringOpen,
+    CharOpen,
+    RawStringOpen,
+    LiteralClose,
+}
+
+/** Preprocessor directives which are relevant for folding. */
+export enum DirectiveType {
+    None,
+    Other,
+    If,
+    Elif,
+    Else,
+    Endif,
+}
+
+/** Lexer states which may continue on the next line. */
+export enum LexState {
+    Code,
+    BlockComment,
+    LineComment,
+    String,
+    Char,
+    RawString,
+}
+
+const CH_TAB = 9;
+const CH_LF = 10;
+const CH_VT = 11;
+const CH_FF = 12;
+const CH_CR = 13;
+const CH_SPACE = 32;
+const CH_QUOTE = 34;
+const CH_HASH = 35;
+const CH_DOLLAR = 36;
+const CH_APOSTROPHE = 39;
+const CH_LPAREN = 40;
+const CH_RPAREN = 41;
+const CH_STAR = 42;
+const CH_PLUS = 43;
+const CH_MINUS = 45;
+const CH_DOT = 46;
+const CH_SLASH = 47;
+const CH_0 = 48;
+const CH_9 = 57;
+const CH_SEMICOLON = 59;
+const CH_A = 65;
+const CH_E = 69;
+const CH_P = 80;
+const CH_R = 82;
+const CH_Z = 90;
+const CH_BACKSLASH = 92;
+const CH_UNDERSCORE = 95;
+const CH_a = 97;
+const CH_e = 101;
+const CH_p = 112;
+const CH_z = 122;
+const CH_LBRACE = 123;
+const CH_RBRACE = 125;
+
+function isWhitespace(c: number) {
+    return c === CH_SPACE || c === CH_TAB || c === CH_VT || c === CH_FF || c === CH_CR || c === CH_LF;
+}
+
+function isIdentifierStart(c: number) {
+    return (c >= CH_a && c <= CH_z) || (c >= CH_A && c <= CH_Z) || c === CH_UNDERSCORE || c === CH_DOLLAR || c > 127;
+}
+
+function isIdentifierPart(c: number) {
+    return isIdentifierStart(c) || (c >= CH_0 && c <= CH_9);
+}
+
+function isDigit(c: number) {
+    return c >= CH_0 && c <= CH_9;
+}
+
+/**
+ * Single pass C/C++ lexer.
+ *
+ * Every line is scanned exactly once, character by character. The tokens of the line
+ * are stored in the token buffers and a small summary of the line is kept in the
+ * public fields, which the folding stages consume instead of searching the line text.
+ * Braces, parentheses, semicolons and keywords are only emitted for code, never for
+ * comments, literals or preprocessor lines. States which span lines (block comments,
+ * raw strings, continued strings, comments or directives) are kept between calls.
+ */
+export default class Lexer {
+
+    /** Token buffers of the last lexed line. */
+    tokenType = new Int32Array(64);
+    tokenCol = new Int32Array(64);
+    tokenFlag = new Int32Array(64);
+    ntokens = 0;
+
+    /** Number of tokens of all lexed lines, for the parse counters. */
+    tokenCount = 0;
+
+    /** Number of chars read of all lexed lines, lookaheads read a char again. */
+    charVisits = 0;
+
+    /** Column of the first non-whitespace character, -1 for blank lines. */
+    indent = -1;
+
+    /** Directive of the line, if it starts a preprocessor directive. */
+    directive = DirectiveType.None;
+
+    /** Number of open and close braces within code. */
+    openBraces = 0;
+    closeBraces = 0;
+
+    /** Number of semicolons within code. */
+    semicolons = 0;
+
+    /** Difference between the number of open and close parentheses within code. */
+    parenDelta = 0;
+
+    /** Column of the first open parenthesis within code or -1. */
+    firstParen = -1;
+
+    /** Whether the word in front of the first parenthesis contains no lower case letters. */
+    firstParenIsMacro = false;
+
+    /** State at the end of the last lexed line. */
+    state = LexState.Code;
+
+    /** Whether the last lexed line is a directive which continues on the next line. */
+    preprocessor = false;
+
+    /** Delimiter of the raw string, if the last lexed line ends within one. */
+    rawDelimiter = '';
+
+    private wordHasLower = false;
+
+    /** Offset of the lexed line within the text, columns are relative to it. */
+    private lineStart_ = 0;
+
+    public reset() {
+        this.ntokens = 0;
+        this.state = LexState.Code;
+        this.preprocessor = false;
+        this.rawDelimiter = '';
+    }
+
+    /** Returns true if the lexer is within a block comment. */
+    public inBlockComment() {
+        return this.state === LexState.BlockComment;
+    }
+
+    /** Lexes a line, which is the whole text or the span from start to end (exclusive). */
+    public lexLine(text: string, start: number = 0, end: number = text.length) {
+        const continued = this.preprocessor;
+        this.lineStart_ = start;
+        this.ntokens = 0;
+        this.directive = DirectiveType.None;
+        this.openBraces = 0;
+        this.closeBraces = 0;
+        this.semicolons = 0;
+        this.parenDelta = 0;
+        this.firstParen = -1;
+        this.firstParenIsMacro = false;
+
+        let pos = start;
+        while (pos < end && isWhitespace(this.charAt(text, pos)))
+            pos++;
+        this.indent = pos < end ? pos - start : -1;
+        this.wordHasLower = false;
+
+        if (this.state === LexState.Code && !continued
+            && pos < end && this.charAt(text, pos) === CH_HASH) {
+            pos = this.lexDirective(text, pos, end);
+        }
+
+        while (pos < end) {
+            if (this.state !== LexState.Code) {
+                pos = this.lexLiteral(text, pos, end);
+                continue;
+            }
+            pos = this.lexCode(text, pos, end);
+        }
+
+        // Close literals which don't continue on the next line
+        const escaped = end > start && this.charAt(text, end - 1) === CH_BACKSLASH;
+        if (this.state === LexState.LineComment
+            || this.state === LexState.String
+            || this.state === LexState.Char) {
+            if (!escaped) {
+                this.push(TokenType.LiteralClose, end, 0);
+                this.state = LexState.Code;
+            }
+        }
+        this.preprocessor = (this.preprocessor || continued) && escaped;
+        this.tokenCount += this.ntokens;
+    }
+
+    /** Reads a char of the text, all reads of the lexer are counted. */
+    private charAt(text: string, pos: number) {
+        this.charVisits++;
+        return text.charCodeAt(pos);
+    }
+
+    /** Checks whether `word` is found in `text` at `pos` without creating substrings. */
+    private matchesAt(text: string, pos: number, word: string) {
+        for (let i = 0; i < word.length; i++) {
+            if (this.charAt(text, pos + i) !== word.charCodeAt(i))
+                return false;
+        }
+        return true;
+    }
+
+    private push(type: TokenType, col: number, flag: number) {
+        if (this.ntokens === this.tokenType.length) {
+            const capacity = this.ntokens * 2;
+            const type_ = new Int32Array(capacity);
+            const col_ = new Int32Array(capacity);
+            const flag_ = new Int32Array(capacity);
+            type_.set(this.tokenType);
+            col_.set(this.tokenCol);
+            flag_.set(this.tokenFlag);
+            this.tokenType = type_;
+            this.tokenCol = col_;
+            this.tokenFlag = flag_;
+        }
+        this.tokenType[this.ntokens] = type;
+        this.tokenCol[this.ntokens] = col - this.lineStart_;
+        this.tokenFlag[this.ntokens] = flag;
+        this.ntokens++;
+    }
+
+    private lexDirective(text: string, pos: number, end: number) {
+        const col = pos;
+        pos++;
+        while (pos < end && isWhitespace(this.charAt(text, pos)))
+            pos++;
+        const nameStart = pos;
+        while (pos < end && isIdentifierPart(this.charAt(text, pos)))
+            pos++;
+        const len = pos - nameStart;
+
+        let type = DirectiveType.Other;
+        if (len >= 2 && this.matchesAt(text, nameStart, 'if'))
+            type = DirectiveType.If;
+        else if (len >= 4 && this.matchesAt(text, nameStart, 'elif'))
+            type = DirectiveType.Elif;
+        else if (len === 4 && this.matchesAt(text, nameStart, 'else'))
+            type = DirectiveType.Else;
+        else if (len === 5 && this.matchesAt(text, nameStart, 'endif'))
+            type = DirectiveType.Endif;
+
+        this.directive = type;
+        this.preprocessor = true;
+        this.push(TokenType.Directive, col, type);
+        return pos;
+    }
+
+    private lexCode(text: string, pos: number, end: number) {
+        const c = this.charAt(text, pos);
+        const code = !this.preprocessor;
+
+        if (isWhitespace(c)) {
+            this.wordHasLower = false;
+            return pos + 1;
+        }
+
+        if (isIdentifierStart(c)) {
+            const start = pos;
+            let hasLower = false;
+            let d = c;
+            do {
+                if (d >= CH_a && d <= CH_z)
+                    hasLower = true;
+                pos++;
+            } while (pos < end && isIdentifierPart(d = this.charAt(text, pos)));
+            if (hasLower)
+                this.wordHasLower = true;
+
+            // Raw string with optional encoding prefix
+            if (pos < end && d === CH_QUOTE
+                && this.charAt(text, pos - 1) === CH_R && this.isRawPrefix(text, start, pos))
+                return this.openRawString(text, pos - 1, end);
+            if (code)
+                this.lexKeyword(text, start, pos);
+            return pos;
+        }
+
+        if (isDigit(c) || (c === CH_DOT && pos + 1 < end && isDigit(this.charAt(text, pos + 1))))
+            return this.lexNumber(text, pos, end);
+
+        switch (c) {
+            case CH_SLASH: {
+                const next = pos + 1 < end ? this.charAt(text, pos + 1) : 0;
+                if (next === CH_SLASH) {
+                    const isDoc = pos + 2 < end && this.charAt(text, pos + 2) === CH_SLASH;
+                    this.push(isDoc ? TokenType.DocLineCommentOpen : TokenType.LineCommentOpen, pos, 0);
+                    this.state = LexState.LineComment;
+                    return end;
+                }
+                if (next === CH_STAR) {
+                    const isDoc = pos + 2 < end && this.charAt(text, pos + 2) === CH_STAR
+                        && !(pos + 3 < end && this.charAt(text, pos + 3) === CH_SLASH);
+                    this.push(isDoc ? TokenType.DocCommentOpen : TokenType.CommentOpen, pos, 0);
+                    this.state = LexState.BlockComment;
+                    return pos + 2;
+                }
+                return pos + 1;
+            }
+            case CH_QUOTE:
+                this.push(TokenType.StringOpen, pos, 0);
+                this.state = LexState.String;
+                return pos + 1;
+            case CH_APOSTROPHE:
+                this.push(TokenType.CharOpen, pos, 0);
+                this.state = LexState.Char;
+                return pos + 1;
+        }
+
+        if (!code)
+            return pos + 1;
+
+        switch (c) {
+            case CH_LBRACE:
+                this.push(TokenType.OpenBrace, pos, 0);
+                this.openBraces++;
+                break;
+            case CH_RBRACE:
+                this.push(TokenType.CloseBrace, pos, 0);
+                this.closeBraces++;
+                break;
+            case CH_LPAREN:
+                if (this.firstParen === -1) {
+                    this.firstParen = pos - this.lineStart_;
+                    this.firstParenIsMacro = !this.wordHasLower;
+                }
+                this.push(TokenType.OpenParen, pos, 0);
+                this.parenDelta++;
+                break;
+            case CH_RPAREN:
+                this.push(TokenType.CloseParen, pos, 0);
+                this.parenDelta--;
+                break;
+            case CH_SEMICOLON:
+                this.push(TokenType.Semicolon, pos, 0);
+                this.semicolons++;
+                break;
+        }
+        return pos + 1;
+    }
+
+    private lexKeyword(text: string, start: number, end: number) {
+        let type = -1;
+        switch (end - start) {
+            case 4:
+                if (this.matchesAt(text, start, 'enum'))
+                    type = TokenType.Enum;
+                else if (this.matchesAt(text, start, 'case'))
+                    type = TokenType.Case;
+                break;
+            case 5:
+                if (this.matchesAt(text, start, 'class'))
+                    type = TokenType.Class;
+                break;
+            case 6:
+                if (this.matchesAt(text, start, 'struct'))
+                    type = TokenType.Struct;
+                else if (this.matchesAt(text, start, 'switch'))
+                    type = TokenType.Switch;
+                break;
+            case 9:
+                if (this.matchesAt(text, start, 'namespace'))
+                    type = TokenType.Namespace;
+                break;
+        }
+        if (type !== -1)
+            this.push(type, start, 0);
+    }
+
+    /** Skips a preprocessing number, so digit separators aren't taken for char literals. */
+    private lexNumber(text: string, pos: number, end: number) {
+        pos++;
+        while (pos < end) {
+            const c = this.charAt(text, pos);
+            if (isIdentifierPart(c) || c === CH_DOT) {
+                pos++;
+            }
+            else if (c === CH_APOSTROPHE && pos + 1 < end && isIdentifierPart(this.charAt(text, pos + 1))) {
+                pos += 2;
+            }
+            else if ((c === CH_PLUS || c === CH_MINUS)) {
+                const prev = this.charAt(text, pos - 1);
+                if (prev !== CH_e && prev !== CH_E && prev !== CH_p && prev !== CH_P)
+                    break;
+                pos++;
+            }
+            else {
+                break;
+            }
+        }
+        return pos;
+    }
+
+    private isRawPrefix(text: string, start: number, end: number) {
+        const len = end - start;
+        return len === 1
+            || (len === 2 && (this.matchesAt(text, start, 'LR') || this.matchesAt(text, start, 'uR') || this.matchesAt(text, start, 'UR')))
+            || (len === 3 && this.matchesAt(text, start, 'u8R'));
+    }
+
+    /** Opens a raw string at `pos` (the 'R' of the prefix) if the delimiter is valid. */
+    private openRawString(text: string, pos: number, end: number) {
+        const quote = pos + 1;
+        let paren = quote + 1;
+        while (paren < end && paren - quote <= 17) {
+            const c = this.charAt(text, paren);
+            if (c === CH_LPAREN)
+                break;
+            if (c === CH_RPAREN || c === CH_BACKSLASH || isWhitespace(c))
+                return quote;
+            paren++;
+        }
+        if (paren >= end || this.charAt(text, paren) !== CH_LPAREN)
+            return quote;
+
+        this.rawDelimiter = text.substring(quote + 1, paren);
+        this.push(TokenType.RawStringOpen, pos, 0);
+        this.state = LexState.RawString;
+        return paren + 1;
+    }
+
+    private lexLiteral(text: string, pos: number, end: number) {
+        switch (this.state) {
+            case LexState.BlockComment: {
+                for (; pos + 1 < end; pos++) {
+                    if (this.charAt(text, pos) === CH_STAR && this.charAt(text, pos + 1) === CH_SLASH) {
+                        this.push(TokenType.LiteralClose, pos, 0);
+                        this.state = LexState.Code;
+                        return pos + 2;
+                    }
+                }
+                return end;
+            }
+            case LexState.String:
+            case LexState.Char: {
+                const quote = this.state === LexState.String ? CH_QUOTE : CH_APOSTROPHE;
+                while (pos < end) {
+                    const c = this.charAt(text, pos);
+                    if (c === CH_BACKSLASH) {
+                        pos += 2;
+                    }
+                    else if (c === quote) {
+                        this.push(TokenType.LiteralClose, pos, 0);
+                        this.state = LexState.Code;
+                        return pos + 1;
+                    }
+                    else {
+                        pos++;
+                    }
+                }
+                return end;
+            }
+            case LexState.RawString: {
+                const delimiter = this.rawDelimiter;
+                const len = delimiter.length;
+                for (; pos + len + 1 < end; pos++) {
+                    if (this.charAt(text, pos) === CH_RPAREN
+                        && this.charAt(text, pos + len + 1) === CH_QUOTE
+                        && this.matchesAt(text, pos + 1, delimiter)) {
+                        this.push(TokenType.LiteralClose, pos, 0);
+                        this.state = LexState.Code;
+                        return pos + len + 2;
+                    }
+                }
+                return end;
+            }
+            default:
+                return end;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+const { performance } = require('perf_hooks');
+
+/** Events of the log, each one is stored as its code & up to five numbers. */
+export enum LogEvent {
+    Message,
+    Error,
+    Provide,
+    CacheHit,
+    ParseCancelled,
+    ShiftLines,
+    ShiftedRanges,
+    Reparsed,
+    Finished,
+    PreprocPush,
+    PreprocAdd,
+    PreprocElsePush,
+    LiteralAdd,
+    FuncIsMacro,
+    FuncCandidate,
+    InnerFuncPush,
+    InnerFuncPop,
+    CasePush,
+    CasePop,
+    CaseAdd,
+    SwitchPush,
+    FuncPush,
+    FuncPop,
+    FuncAdd,
+    WithinFuncAdd,
+    LastCasePop,
+    LastCaseAdd,
+    RangePush,
+    RangeAdd,
+}
+
+const stride = 6;
+
+/**
+ * Ring of the last log events, which keeps the numbers of an event instead of its message,
+ * so logging doesn't allocate. The messages are only created by forEach().
+ */
+export default class LogBuffer {
+
+    private events_: Int32Array;
+    private times_: Float64Array;
+
+    /** Text of the events with a text, e.g. an uri, by slot. */
+    private texts_: Array<string | undefined>;
+
+    /** Slot of the next event & the number of kept events. */
+    private next_ = 0;
+    private length_ = 0;
+
+    constructor(p_capacity: number) {
+        this.events_ = new Int32Array(p_capacity * stride);
+        this.times_ = new Float64Array(p_capacity);
+        this.texts_ = new Array<string | undefined>(p_capacity);
+    }
+
+    get capacity() {
+        return this.times_.length;
+    }
+
+    get length() {
+        return this.length_;
+    }
+
+    public add(event: LogEvent, a: number, b: number, c: number, d: number, e: number, text?: string) {
+        const slot = this.next_;
+        const i = slot * stride;
+        const events = this.events_;
+        events[i] = event;
+        events[i + 1] = a;
+        events[i + 2] = b;
+        events[i + 3] = c;
+        events[i + 4] = d;
+        events[i + 5] = e;
+        this.times_[slot] = performance.now();
+        if (text !== undefined || this.texts_[slot] !== undefined)
+            this.texts_[slot] = text;
+        this.next_ = slot + 1 === this.times_.length ? 0 : slot + 1;
+        if (this.length_ < this.times_.length)
+            this.length_++;
+    }
+
+    public clear() {
+        this.next_ = 0;
+        this.length_ = 0;
+        this.texts_.fill(undefined);
+    }
+
+    /** Calls back with the kept events from the oldest one, the arguments are an array, which is re-used. */
+    public forEach(callback: (event: LogEvent, args: number[], text: string | undefined, time: number) => void) {
+        const capacity = this.times_.length;
+        const args = [0, 0, 0, 0, 0];
+        for (let n = 0; n < this.length_; n++) {
+            const slot = (this.next_ - this.length_ + n + capacity) % capacity;
+            const i = slot * stride;
+            for (let k = 0; k < args.length; k++)
+                args[k] = this.events_[i + 1 + k];
+            callback(this.events_[i], args, this.texts_[slot], this.times_[slot]);
+        }
+    }
+}
\ No newline at end of file
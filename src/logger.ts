@@ -1,8 +1,53 @@
 import * as vscode from 'vscode'
+import LogBuffer, { LogEvent } from './logBuffer';
+import { EntityType } from './parser';
+const { performance } = require('perf_hooks');
 
 export let g_logChannel: vscode.OutputChannel;
 export let logEnable = false;
 
+/** Events, which are kept while the log is enabled, until they are shown. */
+let logBuffer: LogBuffer | undefined = undefined;
+const logCapacity = 65536;
+
+/** Milliseconds from the epoch to the time origin of performance.now(). */
+const timeOrigin = Date.now() - performance.now();
+
+/** Creates the message of each event from its numbers & text. */
+const formats: { [event: number]: (v: number[], text: string) => string } = {
+    [LogEvent.Message]: (v, text) => text,
+    [LogEvent.Error]: (v, text) => text,
+    [LogEvent.Provide]: () => '~~~~~~~~~~~~~~~~~~~~~~~~~~~~~provide~~~~~~~~~~~~~~~~~~~~~~~~~~~~~',
+    [LogEvent.CacheHit]: (v, text) => 'cache hit [V' + v[0] + '] ' + text,
+    [LogEvent.ParseCancelled]: v => 'parse cancelled [V' + v[0] + '] at [L' + v[1] + ']',
+    [LogEvent.ShiftLines]: v => 'shift lines [L' + v[0] + '] by ' + v[1],
+    [LogEvent.ShiftedRanges]: v => 'shifted ranges of ' + v[0] + ' lines',
+    [LogEvent.Reparsed]: v => 're-parsed [L' + v[0] + '->L' + v[1] + '] of ' + v[2] + ' lines',
+    [LogEvent.Finished]: v => 'finished in ' + v[0] + ' lines in ' + (v[1] / 1000) + 'ms',
+    [LogEvent.PreprocPush]: v => 'preproc push: [L' + v[0] + ']',
+    [LogEvent.PreprocAdd]: v => 'preproc block add: [L' + v[0] + '->L' + v[1] + ']',
+    [LogEvent.PreprocElsePush]: v => 'preproc else(if) push: [L' + v[0] + ']',
+    [LogEvent.LiteralAdd]: v => 'literal add: [L' + v[0] + ':' + v[1] + '->L' + v[2] + ':' + v[3]
+        + '] [TYPE:' + EntityType[v[4]] + ']',
+    [LogEvent.FuncIsMacro]: v => 'func is macro [' + v[0] + ']',
+    [LogEvent.FuncCandidate]: v => 'func candidate detect [' + v[0] + ':' + v[1] + ']',
+    [LogEvent.InnerFuncPush]: v => '_func push { [' + v[0] + ']',
+    [LogEvent.InnerFuncPop]: v => '_func pop  } [' + v[0] + ']',
+    [LogEvent.CasePush]: v => 'case push [' + v[0] + ']',
+    [LogEvent.CasePop]: v => 'case pop [' + v[0] + ']',
+    [LogEvent.CaseAdd]: v => 'case add [' + v[0] + '-' + v[1] + '] _____' + (v[1] - v[0]),
+    [LogEvent.SwitchPush]: v => 'switch push { [' + v[0] + ']',
+    [LogEvent.FuncPush]: v => 'func push { [' + v[0] + ']',
+    [LogEvent.FuncPop]: v => 'func pop  } [' + v[0] + ']',
+    [LogEvent.FuncAdd]: v => 'func add [' + v[0] + '-' + v[1] + ']',
+    [LogEvent.WithinFuncAdd]: v => 'within func add [' + v[0] + '-' + v[1] + ']',
+    [LogEvent.LastCasePop]: v => 'last case pop [' + v[0] + ']',
+    [LogEvent.LastCaseAdd]: v => 'last case add [' + v[0] + '-' + v[1] + ']',
+    [LogEvent.RangePush]: v => 'range push { [' + v[0] + '] [TYPE:' + EntityType[v[1]] + ']',
+    [LogEvent.RangeAdd]: v => 'range add: [L' + v[0] + ':' + v[1] + '->L' + v[2] + ':' + v[3]
+        + '] [TYPE:' + EntityType[v[4]] + ']',
+};
+
 function getLogChannel() {
     if (g_logChannel === undefined) {
         g_logChannel = vscode.window.createOutputChannel('cfold');
@@ -14,24 +59,53 @@ function getLogChannel() {
 
 export function toggleLog() {
     logEnable = !logEnable;
+    if (logEnable && logBuffer === undefined)
+        logBuffer = new LogBuffer(logCapacity);
+}
+
+/** Keeps an event, if the log is enabled, the message is only created by showLog(). */
+export function logEvent(event: LogEvent, a = 0, b = 0, c = 0, d = 0, e = 0, text?: string) {
+    if (logEnable && logBuffer !== undefined)
+        logBuffer.add(event, a, b, c, d, e, text);
 }
 
 export function logError(error: any) {
     if (logEnable)
-        getLogChannel().appendLine(`[${getTimeAndms()}][Error] ${error.toString()}`.replace(/(\r\n|\n|\r)/gm, ''));
+        logEvent(LogEvent.Error, 0, 0, 0, 0, 0, error.toString().replace(/(\r\n|\n|\r)/gm, ''));
 }
 
 export function log(message: string) {
     if (logEnable)
-        getLogChannel().appendLine(`[${getTimeAndms()}][Info] ${message}`);
+        logEvent(LogEvent.Message, 0, 0, 0, 0, 0, message);
 }
 
 export function logForce(message: string) {
-    getLogChannel().appendLine(`[${getTimeAndms()}][Info] ${message}`);
+    getLogChannel().appendLine(`[${getTimeAndms(Date.now())}][Info] ${message}`);
+}
+
+/** Writes the kept events to the log channel & removes them. */
+export function showLog() {
+    const channel = getLogChannel();
+    const buffer = logBuffer;
+    if (buffer === undefined || buffer.length === 0) {
+        channel.appendLine(logEnable ? 'No events have been logged yet' : 'The log is disabled, see cfold.toggleLog');
+        channel.show(true);
+        return;
+    }
+    if (buffer.length === buffer.capacity)
+        channel.appendLine('Only the last ' + buffer.capacity + ' events have been kept');
+    const lines = new Array<string>();
+    buffer.forEach((event, args, text, time) => {
+        const level = event === LogEvent.Error ? 'Error' : 'Info';
+        lines.push(`[${getTimeAndms(timeOrigin + time)}][${level}] ${formats[event](args, text || '')}`);
+    });
+    buffer.clear();
+    channel.appendLine(lines.join('\n'));
+    channel.show(true);
 }
 
-function getTimeAndms(): string {
-    const time = new Date();
+function getTimeAndms(ms: number): string {
+    const time = new Date(ms);
     return ('0' + time.getHours()).slice(-2) + ':' +
         ('0' + time.getMinutes()).slice(-2) + ':' +
         ('0' + time.getSeconds()).slice(-2) + '.' +
@@ -0,0 +1,65 @@
+class CacheEntry<T> {
+    version: number;
+    value: T;
+
+    constructor(p_version: number, p_value: T) {
+        this.version = p_version;
+        this.value = p_value;
+    }
+}
+
+/**
+ * Least recently used cache for parse results keyed by document URI & version.
+ *
+ * Only one version is kept per document, a newer version replaces the old one.
+ */
+export default class ParseCache<T> {
+
+    private capacity_: number;
+    private entries_ = new Map<string, CacheEntry<T>>();
+
+    constructor(capacity: number) {
+        this.capacity_ = Math.max(1, capacity);
+    }
+
+    public get size() {
+        return this.entries_.size;
+    }
+
+    /** Returns the cached value if the version matches & marks it as recently used. */
+    public get(uri: string, version: number): T | undefined {
+        const entry = this.entries_.get(uri);
+        if (entry === undefined || entry.version !== version)
+            return undefined;
+        // Map keeps the insertion order, so reinsert to move it to the end
+        this.entries_.delete(uri);
+        this.entries_.set(uri, entry);
+        return entry.value;
+    }
+
+    /** Returns the cached value of any version without marking it as recently used. */
+    public peek(uri: string): T | undefined {
+        const entry = this.entries_.get(uri);
+        return entry === undefined ? undefined : entry.value;
+    }
+
+    public set(uri: string, version: number, value: T) {
+        this.entries_.delete(uri);
+        this.entries_.set(uri, new CacheEntry(version, value));
+        // Evict least recently used entries
+        while (this.entries_.size > this.capacity_) {
+            const oldest = this.entries_.keys().next();
+            if (oldest.done)
+                break;
+            this.entries_.delete(oldest.value);
+        }
+    }
+
+    public delete(uri: string) {
+        this.entries_.delete(uri);
+    }
+
+    public clear() {
+        this.entries_.clear();
+    }
+}
\ No newline at end of file
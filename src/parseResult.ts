@@ -0,0 +1,99 @@
+import RangeStore from './rangeStore';
+import StackPool from './stackPool';
+
+/** Fields of a checkpoint, which holds the parser state at the start of a line & a summary of it. */
+export enum Checkpoint {
+    LexState,
+    LexPreprocessor,
+    RawDelimiter,
+    LiteralLine,
+    LiteralColumn,
+    LiteralFlag,
+    SignatureLine,
+    SignatureColumn,
+    ParenDepth,
+    CandidateLine,
+    CandidateColumn,
+    SwitchSet,
+    BracketType,
+    PreprocTop,
+    RangeTop,
+    FuncTop,
+    CaseLabelTop,
+    PreprocCount,
+    StringCount,
+    FuncCount,
+    WithinFuncCount,
+    CaseLabelCount,
+    RangeCount,
+    LineLength,
+    Blank,
+    Stride,
+}
+
+/**
+ * Ranges found by parsing a single document.
+ */
+export default class ParseResult {
+
+    lineCount = 0;
+
+    /** This range contains preprocessor directives. */
+    preprocRanges = new RangeStore();
+
+    /** This range contains literal ranges like comments or string values. */
+    stringRanges = new RangeStore();
+
+    /** This range contains only function ranges. */
+    funcRanges = new RangeStore();
+
+    /** This range contains only ranges within functions. */
+    withinFuncRanges = new RangeStore();
+
+    /** This range contains casel labels within a switch. */
+    caseLabelRanges = new RangeStore();
+
+    /** This range contains namespaces, classes, structs, enums */
+    ranges = new RangeStore();
+
+    /** Parser state at the start of each line, Checkpoint.Stride fields per line. */
+    checkpoints = new Int32Array(0);
+
+    /** Delimiters of raw strings, which are referenced by the checkpoints. */
+    rawDelimiters = new Array<string>();
+
+    /** Nodes of the parser stacks, which are referenced by the checkpoints. */
+    nodes = new StackPool();
+
+    public clear() {
+        this.lineCount = 0;
+        this.preprocRanges.clear();
+        this.stringRanges.clear();
+        this.funcRanges.clear();
+        this.withinFuncRanges.clear();
+        this.caseLabelRanges.clear();
+        this.ranges.clear();
+        this.rawDelimiters.length = 0;
+        this.nodes.clear();
+    }
+
+    /** Grows the checkpoints to hold at least the given lines, the content is kept. */
+    public reserveCheckpoints(lines: number) {
+        const length = lines * Checkpoint.Stride;
+        if (this.checkpoints.length >= length)
+            return;
+        const resized = new Int32Array(Math.max(length, this.checkpoints.length * 2));
+        resized.set(this.checkpoints);
+        this.checkpoints = resized;
+    }
+
+    /** Returns the index of a raw string delimiter for the checkpoints. */
+    public rawDelimiterIndex(delimiter: string) {
+        let idx = this.rawDelimiters.indexOf(delimiter);
+        if (idx === -1) {
+            idx = this.rawDelimiters.length;
+            this.rawDelimiters.push(delimiter);
+        }
+        return idx;
+    }
+}
\ No newline at end of file
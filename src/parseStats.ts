@@ -0,0 +1,125 @@
+import ParseResult from './parseResult';
+import { ParsePhase } from './parser';
+
+/** How the folding ranges of a request were provided. */
+export type ParseKind = 'cache' | 'full' | 'incremental' | 'shift' | 'worker';
+
+const phaseNames = ['index', 'lex', 'preproc', 'literals', 'functions', 'within', 'brackets', 'splice', 'emit'];
+
+/** Parse of a document version, which provided folding ranges. */
+export class ParseRecord {
+    uri: string;
+    version: number;
+    lineCount: number;
+    kind: ParseKind;
+
+    /** Milliseconds from the request until the folding ranges were created. */
+    time: number;
+    foldingRanges: number;
+
+    /** Found ranges of preprocessor, literals, functions, within functions, case labels & other blocks. */
+    ranges: number[] = [];
+
+    /** Milliseconds per phase, if the phases were timed. */
+    phaseTimes: Float64Array | undefined = undefined;
+
+    constructor(p_uri: string, p_version: number, p_lineCount: number, p_kind: ParseKind, p_time: number,
+        p_foldingRanges: number) {
+        this.uri = p_uri;
+        this.version = p_version;
+        this.lineCount = p_lineCount;
+        this.kind = p_kind;
+        this.time = p_time;
+        this.foldingRanges = p_foldingRanges;
+    }
+
+    public setRanges(result: ParseResult) {
+        this.ranges = [result.preprocRanges.length, result.stringRanges.length, result.funcRanges.length,
+            result.withinFuncRanges.length, result.caseLabelRanges.length, result.ranges.length];
+    }
+
+    public format() {
+        let text = '[V' + this.version + '] ' + this.kind + ' ' + this.lineCount + ' lines in '
+            + this.time.toFixed(2) + 'ms, ' + this.foldingRanges + ' folding ranges';
+        if (this.ranges.length > 0)
+            text += ' (preproc ' + this.ranges[0] + ', literals ' + this.ranges[1] + ', functions ' + this.ranges[2]
+                + ', within ' + this.ranges[3] + ', case ' + this.ranges[4] + ', blocks ' + this.ranges[5] + ')';
+        const phaseTimes = this.phaseTimes;
+        if (phaseTimes !== undefined)
+            text += '\n        ' + phaseNames.map((name, i) => name + ' ' + phaseTimes[i].toFixed(2)).join(', ');
+        return text;
+    }
+}
+
+/** Last parses & the cache hits & misses per document. */
+export default class ParseStats {
+
+    private records_ = new Array<ParseRecord>();
+    private capacity_: number;
+
+    private hits_ = new Map<string, number>();
+    private misses_ = new Map<string, number>();
+
+    /** Milliseconds of the last request of a document if it was a cache hit, otherwise -1. */
+    private lastHit_ = new Map<string, number>();
+
+    /** Called with the uri of a document after each of its requests. */
+    public onChange: ((uri: string) => void) | undefined = undefined;
+
+    constructor(capacity: number) {
+        this.capacity_ = capacity;
+    }
+
+    public add(record: ParseRecord) {
+        if (this.records_.length === this.capacity_)
+            this.records_.shift();
+        this.records_.push(record);
+        this.misses_.set(record.uri, (this.misses_.get(record.uri) || 0) + 1);
+        this.lastHit_.set(record.uri, -1);
+        if (this.onChange !== undefined)
+            this.onChange(record.uri);
+    }
+
+    public addCacheHit(uri: string, time: number) {
+        this.hits_.set(uri, (this.hits_.get(uri) || 0) + 1);
+        this.lastHit_.set(uri, time);
+        if (this.onChange !== undefined)
+            this.onChange(uri);
+    }
+
+    /** Returns the last parse of a document. */
+    public last(uri: string) {
+        for (let i = this.records_.length - 1; i >= 0; i--) {
+            if (this.records_[i].uri === uri)
+                return this.records_[i];
+        }
+        return undefined;
+    }
+
+    public isLastHit(uri: string) {
+        return this.lastHitTime(uri) >= 0;
+    }
+
+    /** Returns the milliseconds of the last request of a document if it was a cache hit, otherwise -1. */
+    public lastHitTime(uri: string) {
+        const time = this.lastHit_.get(uri);
+        return time !== undefined ? time : -1;
+    }
+
+    public delete(uri: string) {
+        this.records_ = this.records_.filter(record => record.uri !== uri);
+        this.hits_.delete(uri);
+        this.misses_.delete(uri);
+        this.lastHit_.delete(uri);
+    }
+
+    /** Returns the lines of the last parses of a document. */
+    public format(uri: string) {
+        const lines = ['cache hits ' + (this.hits_.get(uri) || 0) + ', misses ' + (this.misses_.get(uri) || 0)];
+        for (const record of this.records_) {
+            if (record.uri === uri)
+                lines.push('    ' + record.format());
+        }
+        return lines;
+    }
+}
\ No newline at end of file
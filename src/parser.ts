@@ -0,0 +1,1279 @@
+import Lexer, { DirectiveType, LexState, TokenType } from './lexer';
+import ParseResult, { Checkpoint } from './parseResult';
+import { LogEvent } from './logBuffer';
+const { performance } = require('perf_hooks');
+
+export enum EntityType {
+    Unknown,
+    Class,
+    Comment,
+    CommentQuoteBlock,
+    CommentSlashBlock,
+    Documentation,
+    DocumentationQuoteBlock,
+    DocumentationSlashBlock,
+    Enum,
+    Function,
+    Namespace,
+    Preprocessor,
+    String,
+    StringBlock,
+    Struct,
+    WithinFunction,
+    Switch,
+    Other,
+}
+
+class CharInfo {
+    line: number;
+    column: number;
+    flag: number;
+
+    constructor(p_line: number, p_column: number, p_flag: number = 0) {
+        this.line = p_line;
+        this.column = p_column;
+        this.flag = p_flag;
+    }
+}
+
+/** Options of the parser, which correspond to the `cfold` settings. */
+export class ParserOptions {
+    classEnable = false;
+    commentQuoteEnable = true;
+    documentationQuoteEnable = true;
+    enumEnable = false;
+    functionEnable = true;
+    namespaceEnable = false;
+    preprocessorEnable = false;
+    preprocessorIgnoreGuard = true;
+    preprocessorMinLines = 0;
+    preprocessorRecursiveDepth = 1;
+    structEnable = false;
+    withinFunctionEnable = false;
+    withinFunctionMinLines = 0;
+    caseLabelEnable = false;
+    caseLabelMinLines = 1;
+}
+
+/** Lines of a document version, a `TextDocument` can be passed as is. */
+export interface TextLines {
+    readonly version: number;
+    readonly lineCount: number;
+    lineAt(line: number): { readonly text: string };
+    getText(): string;
+}
+
+/**
+ * Text of a document version & the offset of each line. The lines are scanned within
+ * the text, so no line object or string is created per line.
+ */
+export class TextSnapshot implements TextLines {
+    version: number;
+    text: string;
+    /** Offset of each line, it may have more entries than lines. */
+    lineStarts: Uint32Array;
+    lineCount = 1;
+
+    /** Number of chars read to find the lines, a CR is followed by a lookahead. */
+    charVisits = 0;
+
+    constructor(p_text: string, p_version: number = 0) {
+        this.version = p_version;
+        const text = p_text;
+        // Single scan, the offsets grow on demand
+        let lineStarts = new Uint32Array(Math.max(16, text.length >> 5));
+        let line = 1;
+        let visits = text.length;
+        for (let i = 0; i < text.length; i++) {
+            const c = text.charCodeAt(i);
+            if (c !== 10 && c !== 13)
+                continue;
+            if (c === 13 && i + 1 < text.length) {
+                visits++;
+                if (text.charCodeAt(i + 1) === 10)
+                    continue;
+            }
+            if (line === lineStarts.length) {
+                const grown = new Uint32Array(2 * line);
+                grown.set(lineStarts);
+                lineStarts = grown;
+            }
+            lineStarts[line++] = i + 1;
+        }
+        this.text = text;
+        this.lineStarts = lineStarts;
+        this.lineCount = line;
+        this.charVisits = visits;
+    }
+
+    /** Returns the offset after the last char of a line, the line break is excluded. */
+    public lineEnd(line: number) {
+        if (line + 1 >= this.lineCount)
+            return this.text.length;
+        let end = this.lineStarts[line + 1] - 1;
+        if (end > this.lineStarts[line] && this.text.charCodeAt(end) === 10 && this.text.charCodeAt(end - 1) === 13)
+            end--;
+        return end;
+    }
+
+    public lineAt(line: number) {
+        return { text: this.text.substring(this.lineStarts[line], this.lineEnd(line)) };
+    }
+
+    public getText() {
+        return this.text;
+    }
+}
+
+/** Replaced text of a document change, the positions refer to the document before the change. */
+export interface TextChange {
+    startLine: number;
+    startCharacter: number;
+    endLine: number;
+    endCharacter: number;
+    text: string;
+
+    /** Offset & length of the replaced text. */
+    rangeOffset: number;
+    rangeLength: number;
+}
+
+/** Requests to stop a parse, a `CancellationToken` can be passed as is. */
+export interface CancellationFlag {
+    readonly isCancellationRequested: boolean;
+}
+
+/**
+ * Work of parses in units, which don't depend on the machine: lexed lines, chars & tokens,
+ * stack operations & added ranges. They are accumulated until they are reset.
+ */
+export class ParseCounters {
+    /** Finished parses, incremental ones re-parse from a changed line. */
+    parses = 0;
+    incrementalParses = 0;
+
+    /** Chars of the fully parsed documents, the input of the char visits. */
+    inputChars = 0;
+
+    /** Chars read to find the lines of the text of a full parse. */
+    charsIndexed = 0;
+
+    linesLexed = 0;
+
+    /** Chars read by the lexer, a lookahead reads a char again. */
+    charsLexed = 0;
+    tokens = 0;
+    stackPushes = 0;
+    stackPops = 0;
+    rangesAdded = 0;
+
+    public reset() {
+        Object.assign(this, new ParseCounters());
+    }
+
+    /** Returns the chars read to index & lex per input char. */
+    public charVisitsPerChar() {
+        return this.inputChars === 0 ? 0 : (this.charsIndexed + this.charsLexed) / this.inputChars;
+    }
+}
+
+/** Parse result of a document & the changes since it was parsed. */
+export class ParseState {
+    result = new ParseResult();
+
+    /** Receives the work of the parses, if set. */
+    counters: ParseCounters | undefined = undefined;
+
+    /** Version of the document after the recorded changes, -1 if changes were missed. */
+    editVersion = -1;
+
+    /** Changed lines since the last parse, the end is exclusive before & after the changes. */
+    dirtyStart = -1;
+    dirtyOldEnd = -1;
+    dirtyNewEnd = -1;
+
+    /** Number of stack nodes after the last full parse. */
+    fullParseNodes = 0;
+
+    /** Receives the re-parsed lines of an incremental parse. */
+    scratch = new ParseResult();
+}
+
+/** Phases of a parse, which are timed if enabled. */
+export enum ParsePhase {
+    /** Scanning the text of a full parse for line breaks. */
+    Index,
+    /** Lexing a line & saving its state. */
+    Lex,
+    Preprocessor,
+    /** Comment & string ranges. */
+    Literals,
+    /** Function signatures & bodies. */
+    Functions,
+    /** Blocks & case labels within functions. */
+    WithinFunction,
+    /** Namespace, class, struct & enum blocks. */
+    Brackets,
+    /** Applying the lines of an incremental parse to the result. */
+    Splice,
+    /** Creating the folding ranges, which is timed by the caller. */
+    Emit,
+    Count,
+}
+
+/** Parse of a document version, which can be interrupted after any line & resumed from its checkpoint. */
+export class ParseJob {
+    document: TextLines;
+    state: ParseState;
+    version: number;
+    lineCount: number;
+
+    /** Text of a full parse, an incremental parse reads the few lines it parses one by one. */
+    snapshot: TextSnapshot | undefined = undefined;
+
+    /** Receives the ranges & checkpoints of the parsed lines. */
+    out: ParseResult;
+
+    /** False if only lines were shifted since the last parse. */
+    reparse = true;
+
+    /** First parsed line & the changed lines before & after the changes (exclusive). */
+    from = 0;
+    oldEnd = 0;
+    newEnd = 0;
+    oldLineCount = 0;
+
+    /** Range counts of the unchanged lines in front of the first parsed line. */
+    basePreproc = 0;
+    baseString = 0;
+    baseFunc = 0;
+    baseWithinFunc = 0;
+    baseCaseLabel = 0;
+    baseRange = 0;
+
+    /** Number of stack nodes before the parse. */
+    passNodes = 0;
+
+    /** Next line to parse & the line where the parse stopped. */
+    next = 0;
+    end = -1;
+
+    cancelled = false;
+    startTime: number;
+
+    /** Milliseconds per phase, if the parser times the phases. */
+    phaseTimes: Float64Array | undefined = undefined;
+
+    constructor(p_document: TextLines, p_state: ParseState) {
+        this.document = p_document;
+        this.state = p_state;
+        this.version = p_document.version;
+        this.lineCount = p_document.lineCount;
+        this.out = p_state.result;
+        this.startTime = performance.now();
+    }
+}
+
+/** Receives an event & its numbers, see LogEvent. */
+export type ParserLog = (event: LogEvent, a?: number, b?: number, c?: number, d?: number, e?: number) => void;
+
+/**
+ * Receives the log events, the parser has no access to the log channel within a worker.
+ * Events are only numbers, so a disabled log doesn't create messages.
+ */
+let log: ParserLog = () => { };
+
+export function setParserLog(p_log: ParserLog) {
+    log = p_log;
+}
+
+/** Returns true if the text only contains whitespace, like an empty line for the lexer. */
+function isBlank(text: string) {
+    return /^[ \t\v\f]*$/.test(text);
+}
+
+/** Checks whether the line from start to end (exclusive) ends with a suffix. */
+function endsWith(text: string, start: number, end: number, suffix: string) {
+    const pos = end - suffix.length;
+    if (pos < start)
+        return false;
+    for (let i = 0; i < suffix.length; i++) {
+        if (text.charCodeAt(pos + i) !== suffix.charCodeAt(i))
+            return false;
+    }
+    return true;
+}
+
+/** Returns the number of line breaks of a text. */
+export function countLineBreaks(text: string) {
+    let count = 0;
+    for (let i = 0; i < text.length; i++) {
+        const c = text.charCodeAt(i);
+        if (c === 10 || (c === 13 && text.charCodeAt(i + 1) !== 10))
+            count++;
+    }
+    return count;
+}
+
+/** Returns the number of all ranges of a result. */
+function countRanges(result: ParseResult) {
+    return result.preprocRanges.length + result.stringRanges.length + result.funcRanges.length
+        + result.withinFuncRanges.length + result.caseLabelRanges.length + result.ranges.length;
+}
+
+function getKeywordType(type: TokenType) {
+    switch (type) {
+        case TokenType.Namespace:
+            return EntityType.Namespace;
+        case TokenType.Class:
+            return EntityType.Class;
+        case TokenType.Struct:
+            return EntityType.Struct;
+        case TokenType.Enum:
+            return EntityType.Enum;
+        default:
+            return EntityType.Unknown;
+    }
+}
+
+/**
+ * Folding engine, which parses documents into ranges without depending on the vscode API,
+ * so it can run on the extension host or within a worker.
+ */
+export default class Parser {
+
+    options = new ParserOptions();
+
+    private lexer_ = new Lexer();
+
+    /** Number of popped stack nodes, for the parse counters. */
+    private stackPops_ = 0;
+
+    /** Whether the phases of the parses are timed, which slows down parsing a bit. */
+    public timePhases = false;
+
+    constructor(options?: Partial<ParserOptions>) {
+        if (options !== undefined)
+            Object.assign(this.options, options);
+    }
+
+    /**
+     * Records the changes of a document, so the next parse only re-parses from the first
+     * changed line. The document must already contain the changes. If it contains even later
+     * changes, `latest` must be false, so no lines are read.
+     */
+    public recordChanges(state: ParseState, document: TextLines, changes: TextChange[], latest: boolean = true) {
+        if (state.editVersion === -1 || state.editVersion + 1 !== document.version) {
+            state.editVersion = -1;
+            return;
+        }
+        state.editVersion = document.version;
+        if (changes.length === 0)
+            return;
+
+        // Insert or remove whitespace lines without re-parsing
+        if (latest && state.dirtyStart === -1 && changes.length === 1
+            && this.shiftBlankLines(state.result, document, changes[0]))
+            return;
+
+        // All changes of an event refer to the document before the event
+        let start = Number.MAX_VALUE;
+        let end = 0;
+        let delta = 0;
+        for (const change of changes) {
+            start = Math.min(start, change.startLine);
+            end = Math.max(end, change.endLine + 1);
+            delta += countLineBreaks(change.text) - (change.endLine - change.startLine);
+        }
+
+        // Merge with the changes since the last parse
+        if (state.dirtyStart === -1) {
+            state.dirtyStart = start;
+            state.dirtyOldEnd = end;
+            state.dirtyNewEnd = end + delta;
+        }
+        else {
+            const dirtyEnd = Math.max(state.dirtyNewEnd, end);
+            state.dirtyStart = Math.min(state.dirtyStart, start);
+            state.dirtyOldEnd += dirtyEnd - state.dirtyNewEnd;
+            state.dirtyNewEnd = dirtyEnd + delta;
+        }
+    }
+
+    /** Stops a parse. Its result is incomplete, so the next parse of the document is a full parse. */
+    public cancelParse(job: ParseJob) {
+        job.cancelled = true;
+        job.state.editVersion = -1;
+    }
+
+    /**
+     * Inserts or removes whitespace lines by shifting the ranges & checkpoints of the
+     * following lines. Such lines don't change the parser state, as long as they don't
+     * end a continued directive, string or line comment. Returns false for other changes.
+     */
+    private shiftBlankLines(result: ParseResult, document: TextLines, change: TextChange) {
+        // Lengths decide whether a range within a function is added
+        if (this.options.withinFunctionMinLines !== 0)
+            return false;
+
+        const stride = Checkpoint.Stride;
+        const oldLineCount = result.lineCount;
+        let ck = result.checkpoints;
+
+        // First line, which is inserted or removed
+        let at = -1;
+        let delta = 0;
+        if (change.text.length > 0) {
+            if (change.startLine !== change.endLine || change.startCharacter !== change.endCharacter)
+                return false;
+            const lines = change.text.split(/\r\n|\r|\n/);
+            for (let i = 0; i < lines.length; i++) {
+                if (!isBlank(lines[i]))
+                    return false;
+            }
+            delta = lines.length - 1;
+            if (delta === 0 || change.startLine >= oldLineCount)
+                return false;
+            const prefix = document.lineAt(change.startLine).text.substring(0, change.startCharacter);
+            // Line break at the end of a line
+            if (lines[0].length === 0 && change.startCharacter === ck[change.startLine * stride + Checkpoint.LineLength])
+                at = change.startLine + 1;
+            // Line break in the indentation, which keeps the indentation of the line
+            else if (isBlank(prefix) && lines[lines.length - 1] === prefix)
+                at = change.startLine;
+            else
+                return false;
+        }
+        else {
+            delta = change.startLine - change.endLine;
+            if (delta === 0 || change.endLine >= oldLineCount)
+                return false;
+            // Whole lines from the start of a line or from the end of the previous line
+            if (change.startCharacter === 0 && change.endCharacter === 0)
+                at = change.startLine;
+            else if (change.startCharacter === ck[change.startLine * stride + Checkpoint.LineLength]
+                && change.endCharacter === ck[change.endLine * stride + Checkpoint.LineLength])
+                at = change.startLine + 1;
+            else
+                return false;
+            for (let i = at; i < at - delta; i++) {
+                if (ck[i * stride + Checkpoint.Blank] === 0)
+                    return false;
+            }
+        }
+        if (at >= oldLineCount || document.lineCount !== oldLineCount + delta)
+            return false;
+        const lexState = ck[at * stride + Checkpoint.LexState];
+        if ((lexState !== LexState.Code && lexState !== LexState.BlockComment && lexState !== LexState.RawString)
+            || ck[at * stride + Checkpoint.LexPreprocessor] !== 0)
+            return false;
+
+        // Ranges are stored in the order of the line where they were added,
+        // so the ranges added from the first shifted line on are shifted
+        const shiftLine = delta > 0 ? at : at - delta;
+        const counts = [Checkpoint.PreprocCount, Checkpoint.StringCount, Checkpoint.FuncCount,
+            Checkpoint.WithinFuncCount, Checkpoint.CaseLabelCount, Checkpoint.RangeCount];
+        const stores = [result.preprocRanges, result.stringRanges, result.funcRanges,
+            result.withinFuncRanges, result.caseLabelRanges, result.ranges];
+        for (let k = 0; k < stores.length; k++) {
+            const first = shiftLine < oldLineCount ? ck[shiftLine * stride + counts[k]] : stores[k].length;
+            stores[k].shiftLines(first, shiftLine, delta);
+        }
+
+        // Move the checkpoints, inserted lines have the state of the line they are inserted at
+        const lineCount = oldLineCount + delta;
+        result.reserveCheckpoints(Math.max(oldLineCount, lineCount));
+        ck = result.checkpoints;
+        ck.copyWithin((shiftLine + delta) * stride, shiftLine * stride, oldLineCount * stride);
+        for (let c = (shiftLine + delta) * stride; c < lineCount * stride; c += stride) {
+            if (ck[c + Checkpoint.LiteralLine] >= shiftLine)
+                ck[c + Checkpoint.LiteralLine] += delta;
+            if (ck[c + Checkpoint.SignatureLine] >= shiftLine)
+                ck[c + Checkpoint.SignatureLine] += delta;
+            if (ck[c + Checkpoint.CandidateLine] >= shiftLine)
+                ck[c + Checkpoint.CandidateLine] += delta;
+        }
+        for (let i = at; i < at + delta; i++) {
+            ck.copyWithin(i * stride, (at + delta) * stride, (at + delta + 1) * stride);
+            ck[i * stride + Checkpoint.LineLength] = document.lineAt(i).text.length;
+            ck[i * stride + Checkpoint.Blank] = 1;
+        }
+        result.nodes.shiftLines(result.nodes.length, shiftLine, delta);
+        result.lineCount = lineCount;
+        log(LogEvent.ShiftLines, at, delta);
+        return true;
+    }
+
+
+    /** Parses the document into the state without interruption. */
+    public parseDocument(document: TextLines, state: ParseState) {
+        const job = this.beginParse(document, state);
+        this.runParse(job, Infinity);
+        this.finishParse(job);
+    }
+
+    /**
+     * Prepares a parse of the document into the state. If the changes since the last parse
+     * are known, it resumes from the checkpoint of the first changed line & stops as soon as
+     * the parser state converges with the recorded state of the last parse.
+     */
+    public beginParse(document: TextLines, state: ParseState) {
+        const job = new ParseJob(document, state);
+        if (this.timePhases)
+            job.phaseTimes = new Float64Array(ParsePhase.Count);
+        const result = state.result;
+        const nodes = result.nodes;
+        const lineCount = document.lineCount;
+        const oldLineCount = result.lineCount;
+        const delta = lineCount - oldLineCount;
+        job.oldLineCount = oldLineCount;
+
+        // Only lines were shifted since the last parse
+        if (state.editVersion === document.version && state.dirtyStart === -1 && delta === 0) {
+            job.reparse = false;
+            return job;
+        }
+
+        // Resume from the first changed line, if the changes of this version are known.
+        // Too many unreferenced stack nodes are dropped by a full parse.
+        if (state.editVersion === document.version && state.dirtyStart !== -1
+            && state.dirtyNewEnd - state.dirtyOldEnd === delta
+            && nodes.length <= 4 * state.fullParseNodes + 1024) {
+            job.from = Math.max(0, Math.min(state.dirtyStart, oldLineCount - 1, lineCount - 1));
+            job.oldEnd = state.dirtyOldEnd;
+            job.newEnd = state.dirtyNewEnd;
+        }
+        state.editVersion = document.version;
+        state.dirtyStart = -1;
+
+        // Re-parsed lines are written to the scratch result & spliced into the result afterwards
+        const from = job.from;
+        job.out = from > 0 ? state.scratch : result;
+        job.out.clear();
+        job.out.reserveCheckpoints(lineCount - from);
+        if (from > 0) {
+            const c = from * Checkpoint.Stride;
+            const oldCk = result.checkpoints;
+            job.basePreproc = oldCk[c + Checkpoint.PreprocCount];
+            job.baseString = oldCk[c + Checkpoint.StringCount];
+            job.baseFunc = oldCk[c + Checkpoint.FuncCount];
+            job.baseWithinFunc = oldCk[c + Checkpoint.WithinFuncCount];
+            job.baseCaseLabel = oldCk[c + Checkpoint.CaseLabelCount];
+            job.baseRange = oldCk[c + Checkpoint.RangeCount];
+        }
+        else {
+            nodes.clear();
+            result.rawDelimiters.length = 0;
+            const t0 = performance.now();
+            const snapshot = document instanceof TextSnapshot ? document : new TextSnapshot(document.getText());
+            if (snapshot.lineCount === lineCount)
+                job.snapshot = snapshot;
+            if (job.phaseTimes !== undefined)
+                job.phaseTimes[ParsePhase.Index] += performance.now() - t0;
+            if (state.counters !== undefined) {
+                state.counters.inputChars += snapshot.text.length;
+                state.counters.charsIndexed += snapshot.charVisits;
+            }
+        }
+        job.passNodes = nodes.length;
+        job.next = from;
+        return job;
+    }
+
+
+    /**
+     * Parses the lines of the job until the deadline has passed or the token is cancelled.
+     * Returns true if the parse is finished.
+     */
+    public runParse(job: ParseJob, deadline: number, token?: CancellationFlag) {
+        const counters = job.state.counters;
+        if (counters === undefined || !job.reparse)
+            return this.parseLines(job, deadline, token);
+
+        const out = job.out;
+        const start = job.next;
+        const nodes = job.state.result.nodes.length;
+        const tokens = this.lexer_.tokenCount;
+        const charVisits = this.lexer_.charVisits;
+        const ranges = countRanges(out);
+        const pops = this.stackPops_;
+        const finished = this.parseLines(job, deadline, token);
+
+        // The lines from the start to the end (exclusive) were lexed
+        counters.linesLexed += (finished ? job.end : job.next) - start;
+        counters.charsLexed += this.lexer_.charVisits - charVisits;
+        counters.tokens += this.lexer_.tokenCount - tokens;
+        counters.stackPushes += job.state.result.nodes.length - nodes;
+        counters.stackPops += this.stackPops_ - pops;
+        counters.rangesAdded += countRanges(out) - ranges;
+        return finished;
+    }
+
+    private parseLines(job: ParseJob, deadline: number, token?: CancellationFlag) {
+        if (!job.reparse)
+            return true;
+
+        const options = this.options;
+
+        const document = job.document;
+        const result = job.state.result;
+        const nodes = result.nodes;
+        const lineCount = job.lineCount;
+        const delta = lineCount - job.oldLineCount;
+        const from = job.from;
+        const oldEnd = job.oldEnd;
+        const newEnd = job.newEnd;
+        const start = job.next;
+
+        // Lengths decide whether a range within a function is added,
+        // so the state can't converge if they are changed by the edit
+        const converge = delta === 0 || options.withinFunctionMinLines === 0;
+        const mapLine = (line: number) => line < from ? line : (line >= oldEnd ? line + delta : -2);
+
+        const out = job.out;
+        const ck = out.checkpoints;
+        const oldCk = result.checkpoints;
+        const preprocRanges = out.preprocRanges;
+        const stringRanges = out.stringRanges;
+        const funcRanges = out.funcRanges;
+        const withinFuncRanges = out.withinFuncRanges;
+        const caseLabelRanges = out.caseLabelRanges;
+        const ranges = out.ranges;
+
+        let preprocTop = -1;
+        let rangeTop = -1;
+        let funcTop = -1;
+        let caseLabelTop = -1;
+
+        let literal = new CharInfo(-1, -1);
+
+        let funcSignature = new CharInfo(-1, -1);
+        let funcParenDepth = 0;
+        let funcCandidate = new CharInfo(-1, -1);
+        let funcSwitchSet = false;
+
+        let bracketType = EntityType.Unknown;
+
+        const lexer = this.lexer_;
+        lexer.reset();
+
+        // The time since the last phase change is added to the current phase
+        const phaseTimes = job.phaseTimes;
+        let phase = ParsePhase.Lex;
+        let phaseStart = phaseTimes !== undefined ? performance.now() : 0;
+        const enterPhase = (next: ParsePhase) => {
+            const now = performance.now();
+            phaseTimes![phase] += now - phaseStart;
+            phase = next;
+            phaseStart = now;
+        };
+
+        // Range counts of the unchanged lines in front of the first parsed line
+        const basePreproc = job.basePreproc;
+        const baseString = job.baseString;
+        const baseFunc = job.baseFunc;
+        const baseWithinFunc = job.baseWithinFunc;
+        const baseCaseLabel = job.baseCaseLabel;
+        const baseRange = job.baseRange;
+
+        // Restore the state of the first line, which is the changed line of an incremental
+        // parse or the line where the last time slice stopped
+        if (start > 0) {
+            const src = start === from ? oldCk : ck;
+            const c = (start === from ? start : start - from) * Checkpoint.Stride;
+            lexer.state = src[c + Checkpoint.LexState];
+            lexer.preprocessor = src[c + Checkpoint.LexPreprocessor] !== 0;
+            if (lexer.state === LexState.RawString)
+                lexer.rawDelimiter = result.rawDelimiters[src[c + Checkpoint.RawDelimiter]];
+            literal.line = src[c + Checkpoint.LiteralLine];
+            literal.column = src[c + Checkpoint.LiteralColumn];
+            literal.flag = src[c + Checkpoint.LiteralFlag];
+            funcSignature.line = src[c + Checkpoint.SignatureLine];
+            funcSignature.column = src[c + Checkpoint.SignatureColumn];
+            funcParenDepth = src[c + Checkpoint.ParenDepth];
+            funcCandidate.line = src[c + Checkpoint.CandidateLine];
+            funcCandidate.column = src[c + Checkpoint.CandidateColumn];
+            funcSwitchSet = src[c + Checkpoint.SwitchSet] !== 0;
+            bracketType = src[c + Checkpoint.BracketType];
+            preprocTop = src[c + Checkpoint.PreprocTop];
+            rangeTop = src[c + Checkpoint.RangeTop];
+            funcTop = src[c + Checkpoint.FuncTop];
+            caseLabelTop = src[c + Checkpoint.CaseLabelTop];
+        }
+
+
+        // Iterate lines of document, a line is the span from lineStart to lineEnd of the text
+        const snapshot = job.snapshot;
+        let text = "";
+        let lineStart = 0;
+        let lineEnd = 0;
+        for (let i = start; i < lineCount; i++) {
+            if (phaseTimes !== undefined)
+                enterPhase(ParsePhase.Lex);
+
+            // Stop if the state is the same as the one of the last parse at the unchanged line
+            if (from > 0 && converge && i >= newEnd && i > from) {
+                const c = (i - delta) * Checkpoint.Stride;
+                if (lexer.state === oldCk[c + Checkpoint.LexState]
+                    && (lexer.preprocessor ? 1 : 0) === oldCk[c + Checkpoint.LexPreprocessor]
+                    && (lexer.state !== LexState.RawString
+                        || lexer.rawDelimiter === result.rawDelimiters[oldCk[c + Checkpoint.RawDelimiter]])
+                    && (lexer.state === LexState.Code
+                        || (literal.line === mapLine(oldCk[c + Checkpoint.LiteralLine])
+                            && literal.column === oldCk[c + Checkpoint.LiteralColumn]
+                            && literal.flag === oldCk[c + Checkpoint.LiteralFlag]))
+                    && funcSignature.line === mapLine(oldCk[c + Checkpoint.SignatureLine])
+                    && (funcSignature.line === -1
+                        || (funcSignature.column === oldCk[c + Checkpoint.SignatureColumn]
+                            && funcParenDepth === oldCk[c + Checkpoint.ParenDepth]))
+                    && funcCandidate.line === mapLine(oldCk[c + Checkpoint.CandidateLine])
+                    && (funcCandidate.line === -1
+                        || funcCandidate.column === oldCk[c + Checkpoint.CandidateColumn])
+                    && (funcSwitchSet ? 1 : 0) === oldCk[c + Checkpoint.SwitchSet]
+                    && bracketType === oldCk[c + Checkpoint.BracketType]
+                    && preprocTop === oldCk[c + Checkpoint.PreprocTop]
+                    && rangeTop === oldCk[c + Checkpoint.RangeTop]
+                    && funcTop === oldCk[c + Checkpoint.FuncTop]
+                    && caseLabelTop === oldCk[c + Checkpoint.CaseLabelTop]) {
+                    job.end = i;
+                    return true;
+                }
+            }
+
+            // Save the state at the start of the line
+            const ckLine = (i - from) * Checkpoint.Stride;
+            {
+                const c = ckLine;
+                ck[c + Checkpoint.LexState] = lexer.state;
+                ck[c + Checkpoint.LexPreprocessor] = lexer.preprocessor ? 1 : 0;
+                ck[c + Checkpoint.RawDelimiter] = lexer.state === LexState.RawString
+                    ? result.rawDelimiterIndex(lexer.rawDelimiter) : -1;
+                ck[c + Checkpoint.LiteralLine] = literal.line;
+                ck[c + Checkpoint.LiteralColumn] = literal.column;
+                ck[c + Checkpoint.LiteralFlag] = literal.flag;
+                ck[c + Checkpoint.SignatureLine] = funcSignature.line;
+                ck[c + Checkpoint.SignatureColumn] = funcSignature.column;
+                ck[c + Checkpoint.ParenDepth] = funcParenDepth;
+                ck[c + Checkpoint.CandidateLine] = funcCandidate.line;
+                ck[c + Checkpoint.CandidateColumn] = funcCandidate.column;
+                ck[c + Checkpoint.SwitchSet] = funcSwitchSet ? 1 : 0;
+                ck[c + Checkpoint.BracketType] = bracketType;
+                ck[c + Checkpoint.PreprocTop] = preprocTop;
+                ck[c + Checkpoint.RangeTop] = rangeTop;
+                ck[c + Checkpoint.FuncTop] = funcTop;
+                ck[c + Checkpoint.CaseLabelTop] = caseLabelTop;
+                ck[c + Checkpoint.PreprocCount] = basePreproc + preprocRanges.length;
+                ck[c + Checkpoint.StringCount] = baseString + stringRanges.length;
+                ck[c + Checkpoint.FuncCount] = baseFunc + funcRanges.length;
+                ck[c + Checkpoint.WithinFuncCount] = baseWithinFunc + withinFuncRanges.length;
+                ck[c + Checkpoint.CaseLabelCount] = baseCaseLabel + caseLabelRanges.length;
+                ck[c + Checkpoint.RangeCount] = baseRange + ranges.length;
+            }
+
+            // Interrupt the parse after the state of the line is saved, it's resumed from it
+            if ((i & 127) === 0 && i !== start) {
+                if (token !== undefined && token.isCancellationRequested) {
+                    job.cancelled = true;
+                    job.next = i;
+                    return false;
+                }
+                if (performance.now() > deadline) {
+                    job.next = i;
+                    return false;
+                }
+            }
+
+            if (snapshot !== undefined) {
+                text = snapshot.text;
+                lineStart = snapshot.lineStarts[i];
+                lineEnd = snapshot.lineEnd(i);
+            }
+            else {
+                text = document.lineAt(i).text;
+                lineEnd = text.length;
+            }
+            lexer.lexLine(text, lineStart, lineEnd);
+            ck[ckLine + Checkpoint.LineLength] = lineEnd - lineStart;
+            ck[ckLine + Checkpoint.Blank] = lexer.indent === -1 ? 1 : 0;
+            const ntokens = lexer.ntokens;
+            const tokenType = lexer.tokenType;
+            const tokenCol = lexer.tokenCol;
+
+
+
+
+            ////////////////////////////////////////////////
+            /// Handle preprocessor
+            ////////////////////////////////////////////////
+
+            if (phaseTimes !== undefined)
+                enterPhase(ParsePhase.Preprocessor);
+            if (options.preprocessorEnable && lexer.directive !== DirectiveType.None) {
+                if (lexer.directive === DirectiveType.If) {
+                    log(LogEvent.PreprocPush, i);
+                    let headerDef = 0;
+                    if (options.preprocessorIgnoreGuard
+                        && (endsWith(text, lineStart, lineEnd, '_HPP')
+                            || endsWith(text, lineStart, lineEnd, '_HH')
+                            || endsWith(text, lineStart, lineEnd, '_H')))
+                        headerDef = 1;
+                    preprocTop = nodes.push(preprocTop, i, 0, headerDef);
+                }
+                else if (lexer.directive !== DirectiveType.Other) {
+                    let preprocElse = lexer.directive === DirectiveType.Elif
+                        || lexer.directive === DirectiveType.Else;
+                    if (preprocTop !== -1) {
+                        const pop = preprocTop;
+                        preprocTop = nodes.parent[pop];
+                        this.stackPops_++;
+                        if (nodes.flag[pop] !== 1) {
+                            let mod = 0;
+                            // Shift end to avoid slipping into the scope of #if
+                            if (preprocElse)
+                                mod = 1;
+                            preprocRanges.add(nodes.line[pop], nodes.column[pop], i - mod, 0,
+                                nodes.size(preprocTop), i - nodes.line[pop], EntityType.Preprocessor);
+                            log(LogEvent.PreprocAdd, nodes.line[pop], i - mod);
+                        }
+                    }
+                    if (preprocElse) {
+                        log(LogEvent.PreprocElsePush, i);
+                        preprocTop = nodes.push(preprocTop, i, 0, 0);
+                    }
+                }
+            }
+
+
+
+
+            ////////////////////////////////////////////////
+            /// Handle documentation, comments & string literals
+            ////////////////////////////////////////////////
+
+            if (phaseTimes !== undefined)
+                enterPhase(ParsePhase.Literals);
+            for (let j = 0; j < ntokens; j++) {
+                switch (tokenType[j]) {
+                    case TokenType.CommentOpen:
+                        literal.flag = EntityType.CommentQuoteBlock;
+                        break;
+                    case TokenType.DocCommentOpen:
+                        literal.flag = EntityType.DocumentationQuoteBlock;
+                        break;
+                    case TokenType.LineCommentOpen:
+                        literal.flag = EntityType.Comment;
+                        break;
+                    case TokenType.DocLineCommentOpen:
+                        literal.flag = EntityType.Documentation;
+                        break;
+                    case TokenType.StringOpen:
+                    case TokenType.CharOpen:
+                    case TokenType.RawStringOpen:
+                        literal.flag = EntityType.String;
+                        break;
+                    case TokenType.LiteralClose: {
+                        stringRanges.add(literal.line, literal.column, i, tokenCol[j],
+                            0, i - literal.line, literal.flag);
+                        log(LogEvent.LiteralAdd, literal.line, literal.column, i, tokenCol[j], literal.flag);
+                        continue;
+                    }
+                    default:
+                        continue;
+                }
+                literal.line = i;
+                literal.column = tokenCol[j];
+            }
+
+
+
+
+            ////////////////////////////////////////////////
+            /// Handle functions
+            ////////////////////////////////////////////////
+
+            if (phaseTimes !== undefined)
+                enterPhase(ParsePhase.Functions);
+            if (options.functionEnable) {
+
+                // Check whether it is a start of a function
+                if (funcCandidate.line === -1 && funcSignature.line === -1
+                    && lexer.firstParen !== -1 && lexer.semicolons === 0 && !lexer.inBlockComment()) {
+                    // Check whether it is a macro function call
+                    if (lexer.firstParenIsMacro) {
+                        log(LogEvent.FuncIsMacro, i);
+                        continue;
+                    }
+                    funcSignature.line = i;
+                    funcSignature.column = lexer.indent;
+                    funcParenDepth = 0;
+                }
+
+                // Iterate til to the end of the signature
+                if (funcSignature.line !== -1) {
+                    funcParenDepth += lexer.parenDelta;
+                    if (funcParenDepth > 0)
+                        continue;
+                    const signatureLine = funcSignature.line;
+                    funcSignature.line = -1;
+
+                    // Check again for semicolon at the end of the signature
+                    if (lexer.semicolons > 0)
+                        continue;
+
+                    // Skip one-liner
+                    if (lexer.openBraces > 0 && lexer.openBraces === lexer.closeBraces)
+                        continue;
+
+                    // Probably in function
+                    funcCandidate.line = signatureLine;
+                    funcCandidate.column = funcSignature.column;
+                    log(LogEvent.FuncCandidate, funcCandidate.line, funcCandidate.column);
+
+                    // Push open brackets & pop close brackets
+                    for (let j = 0; j < ntokens; j++) {
+                        if (tokenType[j] === TokenType.OpenBrace) {
+                            log(LogEvent.InnerFuncPush, i);
+                            funcTop = nodes.push(funcTop, i, tokenCol[j], 0);
+                        }
+                    }
+                    for (let j = 0; j < ntokens; j++) {
+                        if (tokenType[j] === TokenType.CloseBrace) {
+                            if (funcTop === -1)
+                                break;
+                            log(LogEvent.InnerFuncPop, i);
+                            funcTop = nodes.parent[funcTop];
+                            this.stackPops_++;
+                        }
+                    }
+                    continue;
+                }
+
+                // Check whether it is within a function. There is no reset of the candidate on a
+                // semicolon before its bracket, a candidate is only set with its bracket.
+                if (funcCandidate.line !== -1) {
+                    if (phaseTimes !== undefined)
+                        enterPhase(ParsePhase.WithinFunction);
+
+                    // Handle switch & case
+                    if (funcTop !== -1 && options.caseLabelEnable) {
+                        let oswitch = -1;
+                        let ocase = -1;
+                        for (let j = 0; j < ntokens; j++) {
+                            if (tokenType[j] === TokenType.Switch && oswitch === -1)
+                                oswitch = tokenCol[j];
+                            else if (tokenType[j] === TokenType.Case && ocase === -1)
+                                ocase = tokenCol[j];
+                        }
+                        // Set switch
+                        if (oswitch !== -1) {
+                            funcSwitchSet = true;
+                        }
+                        // Push case labels
+                        else if (ocase !== -1) {
+
+                            if (caseLabelTop !== -1
+                                // Check if it has the same idention
+                                && nodes.column[caseLabelTop] === ocase) {
+                                log(LogEvent.CasePop, i);
+
+                                const casePop = caseLabelTop;
+                                caseLabelTop = nodes.parent[casePop];
+                                this.stackPops_++;
+                                // Add range, the minimum lines are checked when providing the ranges
+                                log(LogEvent.CaseAdd, nodes.line[casePop], i);
+                                caseLabelRanges.add(nodes.line[casePop], nodes.column[casePop], i - 1, ocase,
+                                    0, i - 1 - nodes.line[casePop], EntityType.Switch);
+                            }
+
+                            caseLabelTop = nodes.push(caseLabelTop, i, ocase, 0);
+                            log(LogEvent.CasePush, i);
+                        }
+                    }
+
+                    // Push all open brackets before popping the close brackets,
+                    // so a `} else {` keeps the whole if-else chain in one range
+                    for (let j = 0; j < ntokens; j++) {
+                        if (tokenType[j] !== TokenType.OpenBrace)
+                            continue;
+                        let funcFlag = 0;
+                        if (funcSwitchSet) {
+                            funcSwitchSet = false;
+                            funcFlag = EntityType.Switch;
+                            log(LogEvent.SwitchPush, i);
+                        }
+                        else {
+                            log(LogEvent.FuncPush, i);
+                        }
+                        funcTop = nodes.push(funcTop, i, tokenCol[j], funcFlag);
+                    }
+
+                    // Pop close brackets
+                    for (let j = 0; j < ntokens; j++) {
+                        if (tokenType[j] !== TokenType.CloseBrace || funcTop === -1)
+                            continue;
+                        const cbracket = tokenCol[j];
+                        log(LogEvent.FuncPop, i);
+                        const pop = funcTop;
+                        funcTop = nodes.parent[pop];
+                        this.stackPops_++;
+                        const popLine = nodes.line[pop];
+                        const popColumn = nodes.column[pop];
+
+                        // Check whether it has the same idention
+                        if (cbracket === funcCandidate.column) {
+                            log(LogEvent.FuncAdd, popLine, i);
+                            // Add range
+                            funcRanges.add(popLine, popColumn, i, cbracket,
+                                0, i - popLine, EntityType.Function);
+                            // Reset
+                            funcCandidate.line = -1;
+                            funcCandidate.column = -1;
+                            funcTop = -1;
+                        }
+                        // Handle brackets within function
+                        else if ((options.withinFunctionEnable || options.caseLabelEnable)
+                            && cbracket >= funcCandidate.column
+                            && popColumn >= funcCandidate.column
+                            && popLine !== i
+                            && i - popLine >= options.withinFunctionMinLines) {
+
+                            if (options.withinFunctionEnable) {
+                                log(LogEvent.WithinFuncAdd, popLine, i);
+                                // Add range
+                                withinFuncRanges.add(popLine, popColumn, i, cbracket,
+                                    0, i - popLine, EntityType.WithinFunction);
+                            }
+
+                            if (options.caseLabelEnable) {
+                                // Check if it is the last case label in the switch
+                                if (caseLabelTop !== -1 && nodes.flag[pop] === EntityType.Switch) {
+                                    log(LogEvent.LastCasePop, i);
+
+                                    const casePop = caseLabelTop;
+                                    caseLabelTop = nodes.parent[casePop];
+                                    this.stackPops_++;
+                                    log(LogEvent.LastCaseAdd, nodes.line[casePop], i);
+                                    // Add range
+                                    caseLabelRanges.add(nodes.line[casePop], nodes.column[casePop], i - 1, cbracket,
+                                        0, i - 1 - nodes.line[casePop], EntityType.Switch);
+                                }
+                            }
+                        }
+                    }
+                    continue;
+                }
+            }
+
+
+
+
+            // After this line non-functions brackets are available.
+            // To correctly process brackets, it needs to push & pop them all
+            if (phaseTimes !== undefined)
+                enterPhase(ParsePhase.Brackets);
+            {
+                // Set identifier for the next bracket
+                for (let j = 0; j < ntokens; j++) {
+                    const type = getKeywordType(tokenType[j]);
+                    if (type !== EntityType.Unknown) {
+                        bracketType = type;
+                        break;
+                    }
+                }
+                // Invalidate identifier if semicolon is found
+                if (bracketType !== EntityType.Unknown) {
+                    if (lexer.semicolons > 0) {
+                        bracketType = EntityType.Unknown;
+                    }
+                }
+            }
+
+
+
+
+            ////////////////////////////////////////////////
+            /// Handle namespaces, structs, classes, enums
+            ////////////////////////////////////////////////
+
+            {
+                for (let j = 0; j < ntokens; j++) {
+                    if (tokenType[j] !== TokenType.OpenBrace)
+                        continue;
+                    log(LogEvent.RangePush, i, bracketType);
+                    rangeTop = nodes.push(rangeTop, i, tokenCol[j], bracketType);
+                }
+                for (let j = 0; j < ntokens; j++) {
+                    if (tokenType[j] !== TokenType.CloseBrace)
+                        continue;
+                    if (rangeTop === -1)
+                        break;
+                    const pop = rangeTop;
+                    rangeTop = nodes.parent[pop];
+                    this.stackPops_++;
+                    ranges.add(nodes.line[pop], nodes.column[pop], i, tokenCol[j],
+                        0, i - nodes.line[pop], nodes.flag[pop]);
+                    log(LogEvent.RangeAdd, nodes.line[pop], nodes.column[pop], i, tokenCol[j], nodes.flag[pop]);
+                }
+            }
+        }
+
+        if (phaseTimes !== undefined)
+            enterPhase(ParsePhase.Lex);
+        job.end = lineCount;
+        return true;
+    }
+
+
+    /** Applies the parsed lines of a finished job to the result of the document. */
+    public finishParse(job: ParseJob) {
+        const state = job.state;
+        const result = state.result;
+        const lineCount = job.lineCount;
+
+        if (!job.reparse) {
+            log(LogEvent.ShiftedRanges, lineCount);
+        }
+        else if (job.from > 0) {
+            const delta = lineCount - job.oldLineCount;
+            log(LogEvent.Reparsed, job.from, job.end, lineCount);
+            const t0 = performance.now();
+            this.spliceResult(result, job.out, job.from, job.end, job.end - delta,
+                job.oldLineCount, job.oldEnd, job.passNodes);
+            if (job.phaseTimes !== undefined)
+                job.phaseTimes[ParsePhase.Splice] += performance.now() - t0;
+        }
+        else {
+            state.fullParseNodes = result.nodes.length;
+        }
+        if (state.counters !== undefined) {
+            state.counters.parses++;
+            if (job.from > 0)
+                state.counters.incrementalParses++;
+        }
+        result.lineCount = lineCount;
+
+        log(LogEvent.Finished, lineCount, Math.round((performance.now() - job.startTime) * 1000));
+    }
+
+    /** Returns the start & end line of the enabled ranges, two entries per range. */
+    public getFoldingLines(result: ParseResult) {
+        const options = this.options;
+        const lines = new Int32Array(2 * (result.preprocRanges.length + result.ranges.length
+            + result.stringRanges.length + result.funcRanges.length
+            + result.withinFuncRanges.length + result.caseLabelRanges.length));
+        let n = 0;
+        if (options.preprocessorEnable) {
+            for (let i = 0; i < result.preprocRanges.length; i++) {
+                if (result.preprocRanges.scope[i] <= options.preprocessorRecursiveDepth
+                    && result.preprocRanges.dist[i] >= options.preprocessorMinLines) {
+                    lines[n++] = result.preprocRanges.startLine[i];
+                    lines[n++] = result.preprocRanges.endLine[i];
+                }
+            }
+        }
+        for (let i = 0; i < result.ranges.length; i++) {
+            if ((options.namespaceEnable && result.ranges.type[i] === EntityType.Namespace)
+                || (options.classEnable && result.ranges.type[i] === EntityType.Class)
+                || (options.structEnable && result.ranges.type[i] === EntityType.Struct)
+                || (options.enumEnable && result.ranges.type[i] === EntityType.Enum)) {
+                lines[n++] = result.ranges.startLine[i];
+                lines[n++] = result.ranges.endLine[i];
+            }
+        }
+        for (let i = 0; i < result.stringRanges.length; i++) {
+            if ((options.documentationQuoteEnable && result.stringRanges.type[i] === EntityType.DocumentationQuoteBlock)
+                || (options.commentQuoteEnable && result.stringRanges.type[i] === EntityType.CommentQuoteBlock)) {
+                lines[n++] = result.stringRanges.startLine[i];
+                lines[n++] = result.stringRanges.endLine[i];
+            }
+        }
+        for (let i = 0; i < result.funcRanges.length; i++) {
+            lines[n++] = result.funcRanges.startLine[i];
+            lines[n++] = result.funcRanges.endLine[i];
+        }
+        for (let i = 0; i < result.withinFuncRanges.length; i++) {
+            lines[n++] = result.withinFuncRanges.startLine[i];
+            lines[n++] = result.withinFuncRanges.endLine[i];
+        }
+        // Double inserts doesn't seem to affect the folding at all
+        for (let i = 0; i < result.caseLabelRanges.length; i++) {
+            if (result.caseLabelRanges.dist[i] >= options.caseLabelMinLines) {
+                lines[n++] = result.caseLabelRanges.startLine[i];
+                lines[n++] = result.caseLabelRanges.endLine[i];
+            }
+        }
+
+        return lines.subarray(0, n);
+    }
+
+    /**
+     * Replaces the ranges & checkpoints of the lines from the resumed line til the converged
+     * line of the last parse with the re-parsed ones. The following ones are shifted by the
+     * changed line count, which is the only work not proportional to the changed lines.
+     */
+    private spliceResult(result: ParseResult, out: ParseResult, from: number, end: number,
+        oldStop: number, oldLineCount: number, oldEnd: number, passNodes: number) {
+        const stride = Checkpoint.Stride;
+        const delta = end - oldStop;
+        const oldCk = result.checkpoints;
+        const counts = [Checkpoint.PreprocCount, Checkpoint.StringCount, Checkpoint.FuncCount,
+            Checkpoint.WithinFuncCount, Checkpoint.CaseLabelCount, Checkpoint.RangeCount];
+        const stores = [result.preprocRanges, result.stringRanges, result.funcRanges,
+            result.withinFuncRanges, result.caseLabelRanges, result.ranges];
+        const outStores = [out.preprocRanges, out.stringRanges, out.funcRanges,
+            out.withinFuncRanges, out.caseLabelRanges, out.ranges];
+        const countDelta = [0, 0, 0, 0, 0, 0];
+
+        // Ranges are stored in the order of their end line
+        let shiftCounts = false;
+        for (let k = 0; k < stores.length; k++) {
+            const store = stores[k];
+            const start = oldCk[from * stride + counts[k]];
+            const stop = oldStop < oldLineCount ? oldCk[oldStop * stride + counts[k]] : store.length;
+            store.splice(start, stop, outStores[k]);
+            if (delta !== 0)
+                store.shiftLines(start + outStores[k].length, oldEnd, delta);
+            countDelta[k] = outStores[k].length - (stop - start);
+            if (countDelta[k] !== 0)
+                shiftCounts = true;
+        }
+
+        // Move the checkpoints of the unchanged lines & copy the re-parsed ones
+        result.reserveCheckpoints(Math.max(oldLineCount, end + oldLineCount - oldStop));
+        const ck = result.checkpoints;
+        if (delta !== 0)
+            ck.copyWithin(end * stride, oldStop * stride, oldLineCount * stride);
+        ck.set(out.checkpoints.subarray(0, (end - from) * stride), from * stride);
+        if (delta !== 0 || shiftCounts) {
+            const length = (end + oldLineCount - oldStop) * stride;
+            for (let c = end * stride; c < length; c += stride) {
+                if (delta !== 0) {
+                    if (ck[c + Checkpoint.LiteralLine] >= oldEnd)
+                        ck[c + Checkpoint.LiteralLine] += delta;
+                    if (ck[c + Checkpoint.SignatureLine] >= oldEnd)
+                        ck[c + Checkpoint.SignatureLine] += delta;
+                    if (ck[c + Checkpoint.CandidateLine] >= oldEnd)
+                        ck[c + Checkpoint.CandidateLine] += delta;
+                }
+                for (let k = 0; k < counts.length; k++)
+                    ck[c + counts[k]] += countDelta[k];
+            }
+        }
+
+        // Stack nodes of the unchanged lines are referenced by the moved checkpoints
+        if (delta !== 0)
+            result.nodes.shiftLines(passNodes, oldEnd, delta);
+    }
+}
+
+/**
+ * Parses a whole text without the vscode API, e.g. for tests, benchmarks or command line tools.
+ * Returns the ranges & the start & end lines of the enabled folding ranges.
+ */
+export function parseText(text: string, options?: Partial<ParserOptions>, counters?: ParseCounters) {
+    const parser = new Parser(options);
+    const state = new ParseState();
+    state.counters = counters;
+    parser.parseDocument(new TextSnapshot(text), state);
+    return { result: state.result, foldingLines: parser.getFoldingLines(state.result) };
+}
\ No newline at end of file
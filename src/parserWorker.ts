@@ -0,0 +1,206 @@
+import Parser, { ParseState, ParserOptions, TextChange, TextLines } from './parser';
+const { parentPort } = require('worker_threads');
+
+/** Changes of a document version. */
+interface WorkerEdit {
+    version: number;
+    changes: TextChange[];
+}
+
+/** Message of the extension host, see ParserWorkerClient. */
+interface WorkerRequest {
+    type: 'options' | 'parse' | 'close';
+    uri: string;
+    version: number;
+    options: ParserOptions;
+
+    /** Set if the document is posted the first time or again after changes were missed. */
+    open: boolean;
+
+    /** Shared UTF-16 text of the document, only posted if it has been replaced. */
+    buffer: SharedArrayBuffer | undefined;
+    length: number;
+
+    /** Unused part of the buffer, the text continues after it. */
+    gapStart: number;
+    gapEnd: number;
+
+    /** Changes since the last request, which have already been written to the text. */
+    edits: WorkerEdit[];
+}
+
+/** Returns the text of a span of char codes, in chunks to stay below the argument limit. */
+function decode(codes: Uint16Array, start: number, end: number): string {
+    const chunk = 4096;
+    if (end - start <= chunk)
+        return String.fromCharCode.apply(null, codes.subarray(start, end));
+    let text = '';
+    for (let i = start; i < end; i += chunk)
+        text += String.fromCharCode.apply(null, codes.subarray(i, Math.min(end, i + chunk)));
+    return text;
+}
+
+/** Document, which is read in place from the text mirror of the extension host. */
+class WorkerDocument implements TextLines {
+    version: number;
+    codes: Uint16Array;
+    length = 0;
+    gapStart = 0;
+    gapLength = 0;
+    state = new ParseState();
+
+    /** Offset of the first char of each line. */
+    private lineStarts_ = new Int32Array(1024);
+    private lineCount_ = 0;
+
+    constructor(p_version: number, p_buffer: SharedArrayBuffer) {
+        this.version = p_version;
+        this.codes = new Uint16Array(p_buffer);
+    }
+
+    /** Takes the bounds of the text after the extension host has written the changes. */
+    public setText(request: WorkerRequest) {
+        if (request.buffer !== undefined)
+            this.codes = new Uint16Array(request.buffer);
+        this.length = request.length;
+        this.gapStart = request.gapStart;
+        this.gapLength = request.gapEnd - request.gapStart;
+    }
+
+    get lineCount() {
+        return this.lineCount_;
+    }
+
+    public lineAt(line: number) {
+        const start = this.lineStarts_[line];
+        let end = this.length;
+        if (line + 1 < this.lineCount_) {
+            end = this.lineStarts_[line + 1] - 1;
+            if (this.charCodeAt(end) === 10 && end > start && this.charCodeAt(end - 1) === 13)
+                end--;
+        }
+        const gapStart = this.gapStart;
+        if (end <= gapStart)
+            return { text: decode(this.codes, start, end) };
+        if (start >= gapStart)
+            return { text: decode(this.codes, start + this.gapLength, end + this.gapLength) };
+        return { text: decode(this.codes, start, gapStart) + decode(this.codes, gapStart + this.gapLength, end + this.gapLength) };
+    }
+
+    public getText() {
+        return decode(this.codes, 0, this.gapStart)
+            + decode(this.codes, this.gapStart + this.gapLength, this.length + this.gapLength);
+    }
+
+    private charCodeAt(offset: number) {
+        return this.codes[offset < this.gapStart ? offset : offset + this.gapLength];
+    }
+
+    /** Moves the line starts by a change, which has already been written to the text. */
+    public applyChange(change: TextChange) {
+        const text = change.text;
+        const start = this.lineStarts_[change.startLine] + change.startCharacter;
+        const end = this.lineStarts_[change.endLine] + change.endCharacter;
+        const delta = text.length - (end - start);
+        const inserted = new Array<number>();
+        for (let i = 0; i < text.length; i++) {
+            const c = text.charCodeAt(i);
+            if (c === 10 || (c === 13 && text.charCodeAt(i + 1) !== 10))
+                inserted.push(start + i + 1);
+        }
+
+        const lineCount = this.lineCount_ - (change.endLine - change.startLine) + inserted.length;
+        this.reserveLines(lineCount);
+        const starts = this.lineStarts_;
+        const first = change.startLine + 1 + inserted.length;
+        starts.copyWithin(first, change.endLine + 1, this.lineCount_);
+        for (let i = 0; i < inserted.length; i++)
+            starts[change.startLine + 1 + i] = inserted[i];
+        for (let i = first; i < lineCount; i++)
+            starts[i] += delta;
+        this.lineCount_ = lineCount;
+    }
+
+    public indexLines() {
+        const length = this.length;
+        this.lineCount_ = 1;
+        this.lineStarts_[0] = 0;
+        for (let i = 0; i < length; i++) {
+            const c = this.charCodeAt(i);
+            if (c === 10 || (c === 13 && (i + 1 === length || this.charCodeAt(i + 1) !== 10))) {
+                this.reserveLines(this.lineCount_ + 1);
+                this.lineStarts_[this.lineCount_++] = i + 1;
+            }
+        }
+    }
+
+    private reserveLines(lines: number) {
+        if (this.lineStarts_.length >= lines)
+            return;
+        const resized = new Int32Array(Math.max(lines, this.lineStarts_.length * 2));
+        resized.set(this.lineStarts_.subarray(0, this.lineCount_));
+        this.lineStarts_ = resized;
+    }
+}
+
+const parser = new Parser();
+const documents = new Map<string, WorkerDocument>();
+
+/** Updates the document by the posted text & changes. Returns undefined if the document isn't known. */
+function updateDocument(request: WorkerRequest) {
+    let document = documents.get(request.uri);
+    if (request.open && request.buffer !== undefined) {
+        const old = document;
+        document = new WorkerDocument(request.version, request.buffer);
+        document.setText(request);
+        document.indexLines();
+        // Re-use the stores of the old document
+        if (old !== undefined) {
+            document.state = old.state;
+            document.state.editVersion = -1;
+        }
+        documents.set(request.uri, document);
+        return document;
+    }
+    if (document === undefined)
+        return undefined;
+
+    document.setText(request);
+    const edits = request.edits;
+    for (let i = 0; i < edits.length; i++) {
+        for (const change of edits[i].changes)
+            document.applyChange(change);
+        document.version = edits[i].version;
+        // Only the text of the last version is available
+        parser.recordChanges(document.state, document, edits[i].changes, i === edits.length - 1);
+    }
+    return document;
+}
+
+parentPort.on('message', (request: WorkerRequest) => {
+    switch (request.type) {
+        case 'options': {
+            Object.assign(parser.options, request.options);
+            // Options change the found ranges, so the next parse is a full parse
+            documents.forEach(document => document.state.editVersion = -1);
+            break;
+        }
+        case 'parse': {
+            // The text is only read until the reply is posted, the extension host writes it afterwards
+            const document = updateDocument(request);
+            if (document === undefined || document.version !== request.version) {
+                documents.delete(request.uri);
+                parentPort.postMessage({ uri: request.uri, version: request.version, lines: undefined });
+                break;
+            }
+            parser.parseDocument(document, document.state);
+            const lines = parser.getFoldingLines(document.state.result);
+            parentPort.postMessage({ uri: request.uri, version: request.version, lines: lines }, [lines.buffer]);
+            break;
+        }
+        case 'close': {
+            documents.delete(request.uri);
+            break;
+        }
+    }
+});
\ No newline at end of file
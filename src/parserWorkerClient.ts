@@ -0,0 +1,283 @@
+import * as path from 'path';
+import { TextDocument } from 'vscode'
+import { logError } from './logger';
+import { ParserOptions, TextChange } from './parser';
+const { Worker } = require('worker_threads');
+
+/** Message of the worker with the start & end lines of the folding ranges, see parserWorker. */
+interface WorkerReply {
+    uri: string;
+    version: number;
+    lines: Int32Array | undefined;
+}
+
+/** Changes of a document version. */
+interface WorkerEdit {
+    version: number;
+    changes: TextChange[];
+}
+
+/**
+ * UTF-16 copy of a document in shared memory, which the worker reads in place.
+ *
+ * The text is stored as gap buffer: the unused capacity is kept at the last changed offset,
+ * so typing only writes the typed chars instead of moving the following text.
+ * The buffer is replaced if the gap is too small.
+ */
+class TextMirror {
+    buffer: SharedArrayBuffer;
+    codes: Uint16Array;
+    length = 0;
+    gapStart = 0;
+    gapEnd = 0;
+
+    /** Set if the buffer has been replaced since it was posted. */
+    replaced = true;
+
+    constructor(text: string) {
+        this.buffer = new SharedArrayBuffer(2 * (text.length + TextMirror.gapSize(text.length)));
+        this.codes = new Uint16Array(this.buffer);
+        this.write(0, text);
+        this.length = text.length;
+        this.gapStart = text.length;
+        this.gapEnd = this.codes.length;
+    }
+
+    /** Replaces the text from an offset on. */
+    public replace(offset: number, removed: number, text: string) {
+        this.moveGap(offset);
+        this.gapEnd += removed;
+        if (this.gapEnd - this.gapStart < text.length)
+            this.grow(this.length - removed + text.length);
+        this.write(this.gapStart, text);
+        this.gapStart += text.length;
+        this.length += text.length - removed;
+    }
+
+    private moveGap(offset: number) {
+        const codes = this.codes;
+        if (offset < this.gapStart) {
+            const moved = this.gapStart - offset;
+            codes.copyWithin(this.gapEnd - moved, offset, this.gapStart);
+            this.gapStart = offset;
+            this.gapEnd -= moved;
+        }
+        else if (offset > this.gapStart) {
+            const moved = offset - this.gapStart;
+            codes.copyWithin(this.gapStart, this.gapEnd, this.gapEnd + moved);
+            this.gapStart = offset;
+            this.gapEnd += moved;
+        }
+    }
+
+    private grow(length: number) {
+        const buffer = new SharedArrayBuffer(2 * (length + TextMirror.gapSize(length)));
+        const codes = new Uint16Array(buffer);
+        const tail = this.codes.length - this.gapEnd;
+        codes.set(this.codes.subarray(0, this.gapStart));
+        codes.set(this.codes.subarray(this.gapEnd), codes.length - tail);
+        this.buffer = buffer;
+        this.codes = codes;
+        this.gapEnd = codes.length - tail;
+        this.replaced = true;
+    }
+
+    private write(offset: number, text: string) {
+        const codes = this.codes;
+        for (let i = 0; i < text.length; i++)
+            codes[offset + i] = text.charCodeAt(i);
+    }
+
+    private static gapSize(length: number) {
+        return Math.max(1024, length >> 3);
+    }
+}
+
+/** Mirror of a document & the changes, which are written to it with the next request. */
+class MirroredDocument {
+    mirror: TextMirror;
+
+    /** Version after the recorded changes. */
+    version: number;
+    edits = new Array<WorkerEdit>();
+
+    /** Cleared if the worker doesn't know the document. */
+    open = true;
+
+    constructor(p_version: number, p_text: string) {
+        this.version = p_version;
+        this.mirror = new TextMirror(p_text);
+    }
+}
+
+class PendingRequest {
+    document: TextDocument;
+    version: number;
+    promise: Promise<Int32Array | undefined>;
+    resolve: (lines: Int32Array | undefined) => void = () => { };
+
+    constructor(p_document: TextDocument) {
+        this.document = p_document;
+        this.version = p_document.version;
+        this.promise = new Promise<Int32Array | undefined>(resolve => this.resolve = resolve);
+    }
+}
+
+/**
+ * Runs the parser in a worker thread. The documents are mirrored in shared memory, so only
+ * their changes are posted, and the worker returns the folding ranges as arrays of lines.
+ *
+ * The worker reads a mirror while it parses the document, so there is at most one request
+ * per document in flight & the changes are written to the mirror before the next one.
+ */
+export default class ParserWorkerClient {
+
+    /** Set if the worker stopped with an error, requests are resolved with undefined. */
+    public failed = false;
+
+    private worker_: any;
+
+    private documents_ = new Map<string, MirroredDocument>();
+
+    /** Request per document, which the worker processes. */
+    private requests_ = new Map<string, PendingRequest>();
+
+    /** Latest request per document, which is posted after the reply of the processed one. */
+    private queued_ = new Map<string, PendingRequest>();
+
+    constructor() {
+        if (typeof SharedArrayBuffer === 'undefined')
+            throw new Error('SharedArrayBuffer is not available');
+        this.worker_ = new Worker(path.join(__dirname, 'parserWorker.js'));
+        this.worker_.on('message', (reply: WorkerReply) => this.onReply(reply));
+        this.worker_.on('error', (error: any) => this.onError(error));
+    }
+
+    public setOptions(options: ParserOptions) {
+        this.worker_.postMessage({ type: 'options', options: options });
+    }
+
+    /** Records the changes of a mirrored document. */
+    public onDidChangeTextDocument(document: TextDocument, changes: TextChange[]) {
+        const uri = document.uri.toString();
+        const mirrored = this.documents_.get(uri);
+        if (mirrored === undefined)
+            return;
+        // The whole text is written again with the next request
+        if (mirrored.version + 1 !== document.version || mirrored.edits.length >= 256) {
+            this.documents_.delete(uri);
+            return;
+        }
+        mirrored.edits.push({ version: document.version, changes: changes });
+        mirrored.version = document.version;
+    }
+
+    public onDidCloseTextDocument(uri: string) {
+        const queued = this.queued_.get(uri);
+        if (queued !== undefined) {
+            this.queued_.delete(uri);
+            queued.resolve(undefined);
+        }
+        if (this.documents_.delete(uri))
+            this.worker_.postMessage({ type: 'close', uri: uri });
+    }
+
+    /** Requests the start & end lines of the folding ranges, undefined if the request is dropped. */
+    public parse(document: TextDocument) {
+        if (this.failed)
+            return Promise.resolve(undefined);
+        const uri = document.uri.toString();
+        const version = document.version;
+
+        const processed = this.requests_.get(uri);
+        if (processed !== undefined && processed.version === version)
+            return processed.promise;
+        const queued = this.queued_.get(uri);
+        if (queued !== undefined && queued.version === version)
+            return queued.promise;
+
+        // Newer versions replace a queued request
+        const request = new PendingRequest(document);
+        if (processed !== undefined) {
+            if (queued !== undefined)
+                queued.resolve(undefined);
+            this.queued_.set(uri, request);
+        }
+        else {
+            this.post(uri, request);
+        }
+        return request.promise;
+    }
+
+    /** Stops the worker, pending requests are resolved with undefined. */
+    public dispose() {
+        this.worker_.terminate();
+        this.dropRequests();
+    }
+
+    /** Writes the changes to the mirror & posts the request. */
+    private post(uri: string, request: PendingRequest) {
+        const document = request.document;
+        if (document.version !== request.version) {
+            request.resolve(undefined);
+            return;
+        }
+
+        let mirrored = this.documents_.get(uri);
+        let edits = new Array<WorkerEdit>();
+        if (mirrored === undefined || mirrored.version !== request.version) {
+            mirrored = new MirroredDocument(request.version, document.getText());
+            this.documents_.set(uri, mirrored);
+        }
+        else {
+            edits = mirrored.edits;
+            mirrored.edits = [];
+            const mirror = mirrored.mirror;
+            for (const edit of edits) {
+                for (const change of edit.changes)
+                    mirror.replace(change.rangeOffset, change.rangeLength, change.text);
+            }
+        }
+
+        const mirror = mirrored.mirror;
+        this.worker_.postMessage({
+            type: 'parse', uri: uri, version: request.version, open: mirrored.open,
+            buffer: mirror.replaced || mirrored.open ? mirror.buffer : undefined,
+            length: mirror.length, gapStart: mirror.gapStart, gapEnd: mirror.gapEnd, edits: edits,
+        });
+        mirror.replaced = false;
+        mirrored.open = false;
+        this.requests_.set(uri, request);
+    }
+
+    private onReply(reply: WorkerReply) {
+        const request = this.requests_.get(reply.uri);
+        if (request === undefined || request.version !== reply.version)
+            return;
+        this.requests_.delete(reply.uri);
+        // The worker dropped the document, so the text is posted again
+        if (reply.lines === undefined)
+            this.documents_.delete(reply.uri);
+        request.resolve(reply.lines);
+
+        const queued = this.queued_.get(reply.uri);
+        if (queued !== undefined) {
+            this.queued_.delete(reply.uri);
+            this.post(reply.uri, queued);
+        }
+    }
+
+    private onError(error: any) {
+        logError(error);
+        this.failed = true;
+        this.dropRequests();
+    }
+
+    private dropRequests() {
+        this.requests_.forEach(request => request.resolve(undefined));
+        this.requests_.clear();
+        this.queued_.forEach(request => request.resolve(undefined));
+        this.queued_.clear();
+        this.documents_.clear();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+/**
+ * Growable range storage with one typed array per field (struct of arrays).
+ *
+ * Ranges are appended & addressed by index, no object is allocated per range.
+ * The columns double their capacity on demand, so any number of ranges can be stored.
+ */
+export default class RangeStore {
+
+    startLine: Int32Array;
+    startCol: Int32Array;
+    endLine: Int32Array;
+    endCol: Int32Array;
+    scope: Int32Array;
+    dist: Int32Array;
+    type: Int32Array;
+
+    /** Number of stored ranges. */
+    length = 0;
+
+    constructor(capacity: number = 64) {
+        this.startLine = new Int32Array(capacity);
+        this.startCol = new Int32Array(capacity);
+        this.endLine = new Int32Array(capacity);
+        this.endCol = new Int32Array(capacity);
+        this.scope = new Int32Array(capacity);
+        this.dist = new Int32Array(capacity);
+        this.type = new Int32Array(capacity);
+    }
+
+    /** Appends a range & returns its index. */
+    public add(startLine: number, startCol: number, endLine: number, endCol: number,
+        scope: number, dist: number, type: number) {
+        if (this.length === this.startLine.length)
+            this.grow(Math.max(16, this.length * 2));
+        const idx = this.length;
+        this.startLine[idx] = startLine;
+        this.startCol[idx] = startCol;
+        this.endLine[idx] = endLine;
+        this.endCol[idx] = endCol;
+        this.scope[idx] = scope;
+        this.dist[idx] = dist;
+        this.type[idx] = type;
+        this.length++;
+        return idx;
+    }
+
+    /** Removes all ranges. The capacity is kept for the next parse. */
+    public clear() {
+        this.length = 0;
+    }
+
+    /** Replaces the ranges from start to end (exclusive) with all ranges of the source. */
+    public splice(start: number, end: number, source: RangeStore) {
+        const length = this.length - end + start + source.length;
+        if (length > this.startLine.length)
+            this.grow(Math.max(16, length * 2));
+        const dst = start + source.length;
+        if (dst !== end) {
+            this.startLine.copyWithin(dst, end, this.length);
+            this.startCol.copyWithin(dst, end, this.length);
+            this.endLine.copyWithin(dst, end, this.length);
+            this.endCol.copyWithin(dst, end, this.length);
+            this.scope.copyWithin(dst, end, this.length);
+            this.dist.copyWithin(dst, end, this.length);
+            this.type.copyWithin(dst, end, this.length);
+        }
+        const n = source.length;
+        this.startLine.set(source.startLine.subarray(0, n), start);
+        this.startCol.set(source.startCol.subarray(0, n), start);
+        this.endLine.set(source.endLine.subarray(0, n), start);
+        this.endCol.set(source.endCol.subarray(0, n), start);
+        this.scope.set(source.scope.subarray(0, n), start);
+        this.dist.set(source.dist.subarray(0, n), start);
+        this.type.set(source.type.subarray(0, n), start);
+        this.length = length;
+    }
+
+    /**
+     * Shifts the ranges from an index on. The end is always shifted, the start only if it
+     * is at or after a line, otherwise the distance grows with the delta.
+     */
+    public shiftLines(start: number, fromLine: number, delta: number) {
+        for (let i = start; i < this.length; i++) {
+            if (this.startLine[i] >= fromLine)
+                this.startLine[i] += delta;
+            else
+                this.dist[i] += delta;
+            this.endLine[i] += delta;
+        }
+    }
+
+    private grow(capacity: number) {
+        this.startLine = RangeStore.resize(this.startLine, capacity);
+        this.startCol = RangeStore.resize(this.startCol, capacity);
+        this.endLine = RangeStore.resize(this.endLine, capacity);
+        this.endCol = RangeStore.resize(this.endCol, capacity);
+        this.scope = RangeStore.resize(this.scope, capacity);
+        this.dist = RangeStore.resize(this.dist, capacity);
+        this.type = RangeStore.resize(this.type, capacity);
+    }
+
+    private static resize(array: Int32Array, capacity: number) {
+        const resized = new Int32Array(capacity);
+        resized.set(array.subarray(0, Math.min(array.length, capacity)));
+        return resized;
+    }
+}
\ No newline at end of file
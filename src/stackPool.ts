@@ -0,0 +1,72 @@
+/**
+ * Pool of persistent stacks, which share their nodes (struct of arrays).
+ *
+ * A stack is addressed by the index of its top node, -1 is the empty stack.
+ * Nodes are never modified by a push or pop, so the index of the top node
+ * is a snapshot of the whole stack & two stacks are equal if their tops are.
+ */
+export default class StackPool {
+
+    line: Int32Array;
+    column: Int32Array;
+    flag: Int32Array;
+    parent: Int32Array;
+    depth: Int32Array;
+
+    /** Number of allocated nodes. */
+    length = 0;
+
+    constructor(capacity: number = 64) {
+        this.line = new Int32Array(capacity);
+        this.column = new Int32Array(capacity);
+        this.flag = new Int32Array(capacity);
+        this.parent = new Int32Array(capacity);
+        this.depth = new Int32Array(capacity);
+    }
+
+    /** Pushes a node onto the stack & returns the new top. */
+    public push(top: number, line: number, column: number, flag: number) {
+        if (this.length === this.line.length)
+            this.grow(Math.max(16, this.length * 2));
+        const idx = this.length;
+        this.line[idx] = line;
+        this.column[idx] = column;
+        this.flag[idx] = flag;
+        this.parent[idx] = top;
+        this.depth[idx] = top === -1 ? 1 : this.depth[top] + 1;
+        this.length++;
+        return idx;
+    }
+
+    /** Returns the number of nodes of the stack. */
+    public size(top: number) {
+        return top === -1 ? 0 : this.depth[top];
+    }
+
+    /** Shifts the line of the nodes below an index, which are at or after a line. */
+    public shiftLines(end: number, fromLine: number, delta: number) {
+        for (let i = 0; i < end; i++) {
+            if (this.line[i] >= fromLine)
+                this.line[i] += delta;
+        }
+    }
+
+    /** Removes all nodes, any stack top becomes invalid. */
+    public clear() {
+        this.length = 0;
+    }
+
+    private grow(capacity: number) {
+        this.line = StackPool.resize(this.line, capacity);
+        this.column = StackPool.resize(this.column, capacity);
+        this.flag = StackPool.resize(this.flag, capacity);
+        this.parent = StackPool.resize(this.parent, capacity);
+        this.depth = StackPool.resize(this.depth, capacity);
+    }
+
+    private static resize(array: Int32Array, capacity: number) {
+        const resized = new Int32Array(capacity);
+        resized.set(array.subarray(0, Math.min(array.length, capacity)));
+        return resized;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+var chai = require("chai");
+chai.config.includeStack = true;
+var assert = chai.assert;
+import * as path from 'path';
+import { parseText } from '../parser';
+import { CorpusShape, generateCpp } from '../bench/corpus';
+const { performance } = require('perf_hooks');
+
+// Parses inputs of n, 2n, 4n & 8n lines, the time must grow about linearly with the size.
+// A quadratic parse takes about 4 times longer per doubling, a linear one 2 times.
+const maxRatio = 2.8;
+
+const allOptions = {
+    classEnable: true, enumEnable: true, namespaceEnable: true, structEnable: true, preprocessorEnable: true,
+    withinFunctionEnable: true, caseLabelEnable: true, caseLabelMinLines: 0,
+};
+
+/// Returns the lines of a construct, which is repeated to get a size.
+function repeat(lines: number, begin: string[], body: (i: number) => string, end: string[]) {
+    let text = begin.slice();
+    for (let i = 0; i < lines; i++)
+        text.push(body(i));
+    return text.concat(end).join('\n');
+}
+
+/// Returns the fastest of a few parses, which is the least disturbed one.
+function measure(text: string) {
+    let best = Number.MAX_VALUE;
+    for (let i = 0; i < 5; i++) {
+        const t0 = performance.now();
+        parseText(text, allOptions);
+        best = Math.min(best, performance.now() - t0);
+    }
+    return best;
+}
+
+/// Checks the average growth of the parse time per doubling of the size.
+function checkGrowth(name: string, generate: (lines: number) => string) {
+    const n = 8000;
+    measure(generate(2 * n));
+    const times = new Array<number>();
+    for (let lines = n; lines <= 8 * n; lines *= 2)
+        times.push(measure(generate(lines)));
+    const ratio = Math.pow(times[3] / times[0], 1 / 3);
+    const message = name + ': ' + times.map(time => time.toFixed(1) + 'ms').join(' ')
+        + ', ratio per doubling ' + ratio.toFixed(2);
+    console.log(message);
+    assert.isAtMost(ratio, maxRatio, message);
+}
+
+describe(path.basename(__filename), function () {
+    this.timeout(120000);
+
+    const shapes: CorpusShape[] = ['nested', 'functions', 'switch', 'docs', 'preprocessor', 'strings', 'raw'];
+    for (const shape of shapes) {
+        it('Scale ' + shape, function () {
+            checkGrowth(shape, lines => generateCpp(lines, shape));
+        })
+    }
+
+    it('Scale one block comment', function () {
+        checkGrowth('block comment', lines => repeat(lines, ['/**'], i => ' * { line ' + i + ' "', [' */']));
+    })
+
+    it('Scale one string literal', function () {
+        checkGrowth('raw string', lines => repeat(lines, ['auto s = R"(', '{'], i => '  // ' + i + ' /* {', [')";']));
+    })
+
+    it('Scale one function', function () {
+        checkGrowth('function', lines => repeat(lines, ['void f()', '{'], i => '    g(' + i + ', "}", \'{\');', ['}']));
+    })
+
+    it('Scale one switch', function () {
+        checkGrowth('switch', lines => repeat(lines, ['void f(int a)', '{', '    switch (a)', '    {'],
+            i => i % 2 === 0 ? '        case ' + i + ':' : '            break;', ['    }', '}']));
+    })
+
+    it('Scale nested blocks', function () {
+        checkGrowth('nested blocks', lines => repeat(lines >> 1, ['void f()', '{'], () => '    if (a) {', [])
+            + '\n' + repeat(lines >> 1, [], () => '    }', ['}']));
+    })
+
+    it('Scale one preprocessor ladder', function () {
+        checkGrowth('preprocessor', lines => repeat(lines, ['#if A'],
+            i => i % 2 === 0 ? 'int a' + i + ';' : '#elif B' + i, ['#endif']));
+    })
+});
\ No newline at end of file
@@ -60,7 +60,7 @@ describe(path.basename(__filename), function () {
         let dumped = 0;
 
         await setDefaultOptions();
-        (<any>provider).updateConfig();
+        provider.updateConfig();
 
         for (let i = 0; i < files.length; i++) {
             let fullFilePath = path.join(test_files, files[i]);
@@ -72,11 +72,11 @@ describe(path.basename(__filename), function () {
             // Set options
             await setDefaultOptions();
             await handleFileOptions(files[i]);
-            (<any>provider).updateConfig();
+            provider.updateConfig();
 
             // Get ranges & check it
             assert.strictEqual(doc.lineCount < maxLines, true);
-            let ranges_undef = provider.provideFoldingRanges(doc);
+            let ranges_undef = await provider.provideFoldingRanges(doc);
             assert.notStrictEqual(ranges_undef, undefined);
             let ranges = (<FoldingRange[]>ranges_undef);
             ranges.sort((n1, n2) => n1.start - n2.start);
@@ -111,6 +111,52 @@ describe(path.basename(__filename), function () {
         assert.strictEqual(dumped, files.length);
     })
 
+    it('Re-use the ranges of an unchanged document', async function () {
+        const content = (await fse.readFile(path.join(test_files, 'switch.cpp'), 'utf8'))
+            .split(/\r?\n/).slice(0, 30).join('\n');
+        let doc = await vscode.workspace.openTextDocument({ language: 'cpp', content: content });
+
+        await setDefaultOptions();
+        provider.updateConfig();
+        provider.cacheEnable = true;
+
+        // The second request of the same version must return the cached ranges without a parse
+        const uri = doc.uri.toString();
+        const first = await provider.provideFoldingRanges(doc);
+        const parse = provider.stats.last(uri);
+        const second = provider.provideFoldingRanges(doc);
+        assert.strictEqual(second, first);
+        assert.isTrue(provider.stats.isLastHit(uri));
+        assert.strictEqual(provider.stats.last(uri), parse);
+    })
+
+    it('Parse in worker', async function () {
+        this.timeout(60000);
+        let files = glob.sync('**/**', { cwd: test_files });
+
+        await setDefaultOptions();
+        provider.updateConfig();
+        const workerProvider = new FoldingProvider(true);
+        await globalConfig.update('parser.worker', true);
+        updateConfig();
+        workerProvider.updateConfig();
+
+        // The worker must provide the same ranges as the extension host
+        const toString = (ranges: FoldingRange[]) =>
+            ranges.map(range => range.start + '-' + range.end).sort().join(' ');
+        for (let i = 0; i < files.length; i++) {
+            let doc = await vscode.workspace.openTextDocument(path.join(test_files, files[i]));
+            let expected = <FoldingRange[]>await provider.provideFoldingRanges(doc);
+            let ranges = <FoldingRange[]>await workerProvider.provideFoldingRanges(doc);
+            assert.notStrictEqual(ranges, undefined);
+            assert.strictEqual(toString(ranges), toString(expected), files[i]);
+        }
+
+        workerProvider.dispose();
+        await globalConfig.update('parser.worker', undefined);
+        updateConfig();
+    })
+
     // Could also check against old dumped files, but for now it seems fine to just
     // check the git diff files
 });
\ No newline at end of file
@@ -0,0 +1,52 @@
+var chai = require("chai");
+chai.config.includeStack = true;
+var assert = chai.assert;
+import * as path from 'path';
+import * as glob from 'glob';
+import * as fse from 'fs-extra';
+import { parseText } from '../parser';
+
+// Compares the folding ranges of the test files with the dumped results of
+// foldingProvider.test.ts, without vscode: npm run test:parser
+
+/// Options of setDefaultOptions() in foldingProvider.test.ts, the provider raises caseLabel.minLines 0 to 1.
+const defaultOptions = {
+    classEnable: true, commentQuoteEnable: true, documentationQuoteEnable: true, enumEnable: true,
+    functionEnable: true, namespaceEnable: true, preprocessorEnable: true, preprocessorIgnoreGuard: true,
+    preprocessorMinLines: 0, preprocessorRecursiveDepth: 1, structEnable: true, withinFunctionEnable: true,
+    withinFunctionMinLines: 0, caseLabelEnable: true, caseLabelMinLines: 1,
+};
+
+/// Appends the fold indicators to the lines like the dump of foldingProvider.test.ts.
+function render(text: string) {
+    const lines = parseText(text, defaultOptions).foldingLines;
+    const ranges = new Array<{ start: number, end: number }>();
+    for (let i = 0; i < lines.length; i += 2)
+        ranges.push({ start: lines[i], end: lines[i + 1] });
+    ranges.sort((n1, n2) => n1.start - n2.start);
+
+    const buffer = text.split(/\r\n|\r|\n/);
+    for (let i = 0; i < ranges.length; i++) {
+        const foldIndicator = " @_" + i + "_";
+        buffer[ranges[i].start] += foldIndicator;
+        buffer[ranges[i].end] += foldIndicator;
+    }
+    return buffer;
+}
+
+describe(path.basename(__filename), function () {
+    const test_files = path.join(__dirname, '../../src/test/test-files');
+    const test_files_results = path.join(__dirname, '../../src/test/results');
+
+    let files = glob.sync('**/**', { cwd: test_files });
+    for (const file of files) {
+        it('Compare ' + file, function () {
+            const actual = render(fse.readFileSync(path.join(test_files, file), 'utf8'));
+            const expected = fse.readFileSync(path.join(test_files_results, file), 'utf8').split('\n');
+
+            // Report the first different line instead of the whole file
+            for (let i = 0; i < Math.max(actual.length, expected.length); i++)
+                assert.strictEqual(actual[i], expected[i], file + ':' + (i + 1));
+        })
+    }
+});
\ No newline at end of file
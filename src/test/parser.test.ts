@@ -0,0 +1,105 @@
+var chai = require("chai");
+chai.config.includeStack = true;
+var assert = chai.assert;
+import * as path from 'path';
+import * as glob from 'glob';
+import * as fse from 'fs-extra';
+import Parser, { ParseCounters, ParseState, TextSnapshot, parseText } from '../parser';
+
+// The parser doesn't depend on the vscode API, so these tests also run in plain node:
+// npm run test:parser
+
+/// Returns the folding lines as sorted list of ranges.
+function toString(lines: Int32Array) {
+    let ranges = new Array<string>();
+    for (let i = 0; i < lines.length; i += 2)
+        ranges.push(lines[i] + '-' + lines[i + 1]);
+    return ranges.sort().join(' ');
+}
+
+describe(path.basename(__filename), function () {
+    const test_files = path.join(__dirname, '../../src/test/test-files');
+
+    it('Fold functions', function () {
+        const text = 'int main()\n{\n    return 0;\n}\n';
+        assert.strictEqual(toString(parseText(text).foldingLines), '1-3');
+    })
+
+    it('Fold enabled ranges only', function () {
+        const text = '/*\n * comment\n */\nclass A\n{\n    int a;\n};\n';
+        assert.strictEqual(toString(parseText(text, { classEnable: true }).foldingLines), '0-2 4-6');
+        assert.strictEqual(toString(parseText(text, { commentQuoteEnable: false }).foldingLines), '');
+    })
+
+    it('Fold preprocessor directives', function () {
+        const text = '#if X\nint a;\n#endif\n';
+        assert.strictEqual(toString(parseText(text, { preprocessorEnable: true }).foldingLines), '0-2');
+        assert.strictEqual(toString(parseText(text).foldingLines), '');
+    })
+
+    it('Handle CRLF line breaks', function () {
+        const text = 'void f()\r\n{\r\n    if (a) {\r\n        b();\r\n    }\r\n}';
+        assert.strictEqual(toString(parseText(text, { withinFunctionEnable: true }).foldingLines), '1-5 2-4');
+    })
+
+    it('Count the work of a parse', function () {
+        const text = fse.readFileSync(path.join(test_files, 'indexer.cpp'), 'utf8');
+        const counters = new ParseCounters();
+        const result = parseText(text, { withinFunctionEnable: true }, counters).result;
+
+        // Each char is indexed once & lexed with few lookaheads, e.g. of // & */
+        assert.strictEqual(counters.linesLexed, result.lineCount);
+        assert.strictEqual(counters.charsIndexed, counters.inputChars);
+        assert.isAtMost(counters.charsLexed, 1.25 * counters.inputChars);
+        assert.isAtMost(counters.charVisitsPerChar(), 2.25);
+        assert.strictEqual(counters.stackPops <= counters.stackPushes, true);
+
+        // Typing within a function body only re-parses the changed line
+        const parser = new Parser({ withinFunctionEnable: true });
+        const state = new ParseState();
+        let document = new TextSnapshot(text, 1);
+        parser.parseDocument(document, state);
+        const line = 700;
+        const offset = document.lineStarts[line];
+        document = new TextSnapshot(text.substring(0, offset) + ' ' + text.substring(offset), 2);
+        parser.recordChanges(state, document, [{
+            startLine: line, startCharacter: 0, endLine: line, endCharacter: 0, text: ' ', rangeOffset: offset, rangeLength: 0,
+        }]);
+        state.counters = new ParseCounters();
+        parser.parseDocument(document, state);
+        assert.strictEqual(state.counters.incrementalParses, 1);
+        assert.isAtMost(state.counters.linesLexed, 2);
+        assert.isAtMost(state.counters.charsLexed, 2 * document.lineAt(line).text.length);
+    })
+
+    it('Re-parse changed lines', function () {
+        const options = { classEnable: true, enumEnable: true, namespaceEnable: true, structEnable: true,
+            preprocessorEnable: true, withinFunctionEnable: true, caseLabelEnable: true };
+        const edits = ['{\n', '}', '/*', '\n\n', 'int f() {\n', ''];
+        let files = glob.sync('**/**', { cwd: test_files });
+
+        for (let i = 0; i < files.length; i++) {
+            let text = fse.readFileSync(path.join(test_files, files[i]), 'utf8');
+            const parser = new Parser(options);
+            const state = new ParseState();
+            let document = new TextSnapshot(text, 1);
+            parser.parseDocument(document, state);
+
+            // Each edit must give the same ranges as a parse of the whole text
+            for (let j = 0; j < edits.length; j++) {
+                const line = Math.floor(document.lineCount * (j + 1) / (edits.length + 1));
+                const offset = document.lineStarts[line];
+                const removed = edits[j].length === 0 ? document.lineEnd(line) - offset : 0;
+                text = text.substring(0, offset) + edits[j] + text.substring(offset + removed);
+                document = new TextSnapshot(text, document.version + 1);
+                parser.recordChanges(state, document, [{
+                    startLine: line, startCharacter: 0, endLine: line, endCharacter: removed,
+                    text: edits[j], rangeOffset: offset, rangeLength: removed,
+                }]);
+                parser.parseDocument(document, state);
+                assert.strictEqual(toString(parser.getFoldingLines(state.result)),
+                    toString(parseText(text, options).foldingLines), files[i] + ' edit ' + j);
+            }
+        }
+    })
+});
\ No newline at end of file